@@ -0,0 +1,79 @@
+// measuring helpers of the benchmarks, see bench/index.js
+
+const EventEmitter = require('events').EventEmitter
+const { performance, PerformanceObserver } = require('perf_hooks')
+const mineflayer = require('../')
+
+// how long each benchmark runs, after warming up for a tenth of that
+const DURATION_MS = parseInt(process.env.BENCH_DURATION_MS || '1000')
+
+let gcCount = 0
+const gcObserver = new PerformanceObserver(list => { gcCount += list.getEntries().length })
+gcObserver.observe({ entryTypes: ['gc'] })
+
+/**
+ * Calls fn until DURATION_MS elapsed.
+ * fn does `ops` operations per call, 1 by default.
+ * @return {Object} { opsPerSec, bytesPerOp, gcs } bytesPerOp is the growth of the heap per operation
+ * (between collections, so it's an estimate of what was allocated), gcs the number of collections
+ */
+function measure (fn, ops = 1) {
+  run(fn, DURATION_MS / 10)
+  if (global.gc) global.gc()
+  const gcsBefore = gcCount
+  const result = run(fn, DURATION_MS)
+  return {
+    opsPerSec: result.calls * ops / (result.elapsed / 1000),
+    bytesPerOp: result.allocated / (result.calls * ops),
+    gcs: gcCount - gcsBefore
+  }
+}
+
+function run (fn, duration) {
+  let calls = 0
+  let allocated = 0
+  let heapUsed = process.memoryUsage().heapUsed
+  const start = performance.now()
+  let elapsed = 0
+  while (elapsed < duration) {
+    // checking the time and the heap every call would be more than some benchmarks
+    for (let i = 0; i < 10; i++) fn(calls++)
+    const now = process.memoryUsage().heapUsed
+    // a collection happened when it shrank
+    if (now > heapUsed) allocated += now - heapUsed
+    heapUsed = now
+    elapsed = performance.now() - start
+  }
+  return { calls, elapsed, allocated }
+}
+
+/**
+ * A bot that isn't connected to anything: packets are emitted on bot._client
+ * with client.receive(name, params) and what the bot writes is dropped.
+ * Its player is logged in and spawned at spawnPosition.
+ */
+function createBenchBot (version, options = {}, spawnPosition = { x: 0.5, y: 80, z: 0.5 }) {
+  const client = new EventEmitter()
+  client.version = version
+  client.username = 'bench'
+  client.write = () => {}
+  client.end = () => client.emit('end')
+  client.receive = (name, params) => client.emit(name, params)
+  const bot = mineflayer.createBot(Object.assign({ version, client, logErrors: false }, options))
+  client.receive('login', {
+    entityId: 1,
+    levelType: 'default',
+    gameMode: 0,
+    dimension: 0,
+    difficulty: 0,
+    maxPlayers: 20,
+    reducedDebugInfo: false
+  })
+  client.receive('position', Object.assign({ yaw: 0, pitch: 0, flags: 0, teleportId: 0 }, spawnPosition))
+  return bot
+}
+
+module.exports = {
+  measure,
+  createBenchBot
+}
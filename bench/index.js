@@ -0,0 +1,146 @@
+// benchmarks of the hot paths of mineflayer, run with `npm run bench`
+// usage : node bench [name filter] [--json]
+// BENCH_VERSION selects the minecraft version (1.12.2 by default), BENCH_DURATION_MS how long each benchmark runs.
+// BENCH_RECORDING is a recording of mineflayer.recordPackets to also measure how fast it's replayed.
+// run node with --expose-gc for more stable allocation numbers
+
+const Vec3 = require('vec3').Vec3
+const { performance } = require('perf_hooks')
+const mineflayer = require('../')
+const { measure, createBenchBot } = require('./harness')
+const packets = require('./packets')
+
+const version = process.env.BENCH_VERSION || '1.12.2'
+const args = process.argv.slice(2)
+const json = args.includes('--json')
+const filter = args.find(arg => arg !== '--json')
+
+// columns of the world the bots stand in, from -RADIUS to RADIUS - 1
+const RADIUS = 4
+
+function loadWorld (bot) {
+  for (let x = -RADIUS; x < RADIUS; x++) {
+    for (let z = -RADIUS; z < RADIUS; z++) bot._client.receive('map_chunk', packets.mapChunk(version, x, z))
+  }
+}
+
+// pseudo random so every run measures the same thing
+function positions (count) {
+  const list = []
+  let seed = 42
+  const next = () => {
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff
+    return seed / 0x7fffffff
+  }
+  for (let i = 0; i < count; i++) {
+    list.push(new Vec3(Math.floor((next() * 2 - 1) * RADIUS * 16), Math.floor(next() * 80), Math.floor((next() * 2 - 1) * RADIUS * 16)))
+  }
+  return list
+}
+
+const benchmarks = {
+  'map_chunk ingest' () {
+    const bot = createBenchBot(version)
+    const columns = []
+    for (let x = 0; x < 4; x++) {
+      for (let z = 0; z < 4; z++) columns.push(packets.mapChunk(version, x, z))
+    }
+    return [bot, measure(i => bot._client.receive('map_chunk', columns[i % columns.length]))]
+  },
+  'map_chunk ingest, lazyChunkLoading' () {
+    const bot = createBenchBot(version, { lazyChunkLoading: true })
+    const columns = []
+    for (let x = 0; x < 4; x++) {
+      for (let z = 0; z < 4; z++) columns.push(packets.mapChunk(version, x, z))
+    }
+    return [bot, measure(i => bot._client.receive('map_chunk', columns[i % columns.length]))]
+  },
+  blockAt () {
+    const bot = createBenchBot(version)
+    loadWorld(bot)
+    const points = positions(4096)
+    return [bot, measure(i => bot.blockAt(points[i % points.length]))]
+  },
+  blockStateAt () {
+    const bot = createBenchBot(version)
+    loadWorld(bot)
+    const points = positions(4096)
+    return [bot, measure(i => {
+      const point = points[i % points.length]
+      bot.blockStateAt(point.x, point.y, point.z)
+    })]
+  },
+  findBlock () {
+    const bot = createBenchBot(version, {}, { x: 0.5, y: 20, z: 0.5 })
+    loadWorld(bot)
+    const ore = require('minecraft-data')(version).blocksByName.diamond_ore.id
+    return [bot, measure(() => bot.findBlock({ matching: ore, maxDistance: 32 }))]
+  },
+  'physics ticks' () {
+    const bot = createBenchBot(version, {}, { x: 0.5, y: 64, z: 0.5 })
+    loadWorld(bot)
+    const controls = { forward: true, sprint: true }
+    return [bot, measure(() => bot.simulate(null, controls, 20), 20)]
+  },
+  'raycast (blockInSight)' () {
+    const bot = createBenchBot(version, {}, { x: 0.5, y: 70, z: 0.5 })
+    loadWorld(bot)
+    bot.entity.pitch = -0.6
+    return [bot, measure(i => {
+      bot.entity.yaw = i * 0.01
+      bot.blockInSight()
+    })]
+  },
+  canSeeBlock () {
+    const bot = createBenchBot(version, {}, { x: 0.5, y: 64, z: 0.5 })
+    loadWorld(bot)
+    const blocks = positions(256).map(point => bot.blockAt(point))
+    return [bot, measure(i => bot.canSeeBlock(blocks[i % blocks.length]))]
+  },
+  'chat packets' () {
+    const bot = createBenchBot(version)
+    bot.chatAddPattern(/^\[(\w+) -> me\] (.*)$/, 'whisper', 'bench whisper')
+    const messages = [packets.chat('alice', 'hello there'), packets.chat('bob', 'how are you'), packets.chat('carol', 'fine')]
+    return [bot, measure(i => bot._client.receive('chat', messages[i % messages.length]))]
+  },
+  'entity packets' () {
+    const bot = createBenchBot(version)
+    for (let id = 10; id < 110; id++) bot._client.receive('spawn_entity_living', packets.spawnMob(version, id, id % 10, 64, Math.floor(id / 10)))
+    const moves = []
+    for (let id = 10; id < 110; id++) moves.push(packets.relEntityMove(version, id, 1), packets.relEntityMove(version, id, -1))
+    return [bot, measure(i => bot._client.receive('rel_entity_move', moves[i % moves.length]))]
+  }
+}
+
+const results = {}
+for (const name in benchmarks) {
+  if (filter && !name.includes(filter)) continue
+  const [bot, result] = benchmarks[name]()
+  bot.end()
+  results[name] = result
+  if (!json) {
+    console.log(`${name.padEnd(36)} ${Math.round(result.opsPerSec).toLocaleString().padStart(14)} ops/sec ${Math.round(result.bytesPerOp).toLocaleString().padStart(10)} bytes/op ${String(result.gcs).padStart(5)} gcs`)
+  }
+}
+
+function print () {
+  if (json) console.log(JSON.stringify({ version, node: process.version, results }, null, 2))
+}
+
+// replaying is asynchronous, so it's measured once, after the others
+const recording = process.env.BENCH_RECORDING
+if (recording && (!filter || 'replay'.includes(filter))) {
+  const client = mineflayer.createReplayClient(recording, { speed: Infinity })
+  const bot = mineflayer.createBot({ client, logErrors: false })
+  let count = 0
+  client.on('packet', () => count++)
+  const start = performance.now()
+  bot.on('end', () => {
+    const elapsed = performance.now() - start
+    results.replay = { packets: count, packetsPerSec: count / (elapsed / 1000) }
+    if (!json) console.log(`${'replay'.padEnd(36)} ${Math.round(results.replay.packetsPerSec).toLocaleString().padStart(14)} packets/sec`)
+    print()
+  })
+} else {
+  print()
+}
@@ -0,0 +1,73 @@
+// packets fed to the benchmark bots, built like a server would send them
+
+const Vec3 = require('vec3').Vec3
+
+// the column at (chunkX, chunkZ): stone up to y 60, then dirt and grass, with ore veins
+function mapChunk (version, chunkX, chunkZ) {
+  const mcData = require('minecraft-data')(version)
+  const Chunk = require('prismarine-chunk')(version)
+  const column = new Chunk()
+  const stone = mcData.blocksByName.stone.id
+  const dirt = mcData.blocksByName.dirt.id
+  const grass = (mcData.blocksByName.grass_block || mcData.blocksByName.grass).id
+  const ore = mcData.blocksByName.diamond_ore.id
+  const position = new Vec3(0, 0, 0)
+  for (let x = 0; x < 16; x++) {
+    for (let z = 0; z < 16; z++) {
+      for (let y = 0; y <= 63; y++) {
+        position.set(x, y, z)
+        const isOre = y < 16 && (x * 7 + y * 3 + z * 5 + chunkX + chunkZ) % 97 === 0
+        column.setBlockType(position, y === 63 ? grass : y > 60 ? dirt : isOre ? ore : stone)
+        column.setSkyLight(position, y === 63 ? 15 : 0)
+      }
+    }
+  }
+  return {
+    x: chunkX,
+    z: chunkZ,
+    groundUp: true,
+    bitMap: typeof column.getMask === 'function' ? column.getMask() : 0xffff,
+    chunkData: column.dump(),
+    blockEntities: []
+  }
+}
+
+function spawnMob (version, entityId, x, y, z) {
+  const mcData = require('minecraft-data')(version)
+  const zombie = mcData.entitiesByName.zombie || mcData.entitiesByName.Zombie
+  return {
+    entityId,
+    entityUUID: '00112233-4455-6677-8899-aabbccddeeff',
+    type: zombie.id,
+    x,
+    y,
+    z,
+    yaw: 0,
+    pitch: 0,
+    headPitch: 0,
+    velocityX: 0,
+    velocityY: 0,
+    velocityZ: 0,
+    metadata: []
+  }
+}
+
+// a move of a tenth of a block along x
+function relEntityMove (version, entityId, sign) {
+  const scale = require('minecraft-data')(version).version.majorVersion === '1.8' ? 32 : 128 * 32
+  return { entityId, dX: Math.round(sign * scale / 10), dY: 0, dZ: 0, onGround: true }
+}
+
+function chat (username, message) {
+  return {
+    message: JSON.stringify({ translate: 'chat.type.text', with: [{ text: username }, message] }),
+    position: 0
+  }
+}
+
+module.exports = {
+  mapChunk,
+  spawnMob,
+  relEntityMove,
+  chat
+}
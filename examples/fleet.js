@@ -0,0 +1,23 @@
+// runs bots in one worker thread per core
+const mineflayer = require('mineflayer')
+
+if (process.argv.length < 4 || process.argv.length > 5) {
+  console.log('Usage : node fleet.js <host> <port> [count]')
+  process.exit(1)
+}
+
+const fleet = new mineflayer.Fleet({ shareWorld: true })
+const count = parseInt(process.argv[4] || '100')
+
+for (let i = 0; i < count; i++) {
+  const bot = fleet.createBot({
+    host: process.argv[2],
+    port: parseInt(process.argv[3]),
+    username: `mineflayer-bot${i}`
+  })
+  bot.on('chat', (username, message) => {
+    if (username === bot.username) return
+    if (message === 'where') bot.chat(`I am at ${bot.entity.position}`)
+    if (message === 'quit') fleet.close()
+  })
+}
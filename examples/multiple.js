@@ -5,6 +5,9 @@ if (process.argv.length < 3 || process.argv.length > 5) {
   process.exit(1)
 }
 
+// all the bots share their copy of the world
+const world = new mineflayer.World()
+
 let i = 0
 function next () {
   if (i < 10) {
@@ -21,6 +24,7 @@ function createBot (name) {
   mineflayer.createBot({
     host: process.argv[2],
     port: parseInt(process.argv[3]),
-    username: name
+    username: name,
+    world
   })
 }
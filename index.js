@@ -5,6 +5,7 @@ const plugins = {
   bed: require('./lib/plugins/bed'),
   title: require('./lib/plugins/title'),
   block_actions: require('./lib/plugins/block_actions'),
+  block_index: require('./lib/plugins/block_index'),
   blocks: require('./lib/plugins/blocks'),
   book: require('./lib/plugins/book'),
   boss_bar: require('./lib/plugins/boss_bar'),
@@ -35,6 +36,10 @@ const plugins = {
   time: require('./lib/plugins/time'),
   villager: require('./lib/plugins/villager')
 }
+// the internal plugins loaded with the lean option
+const leanPlugins = ['blocks', 'chat', 'entities', 'game', 'health', 'inventory', 'kick', 'physics', 'settings', 'simple_inventory']
+const skipUnusedPackets = require('./lib/packet_filter')
+const coalesceWrites = require('./lib/coalesce_writes')
 const supportedVersions = require('./lib/version').supportedVersions
 const testedVersions = require('./lib/version').testedVersions
 
@@ -48,6 +53,10 @@ module.exports = {
   EnchantmentTable: require('./lib/enchantment_table'),
   ScoreBoard: require('./lib/scoreboard'),
   BossBar: require('./lib/bossbar'),
+  World: require('./lib/world'),
+  Fleet: require('./lib/fleet'),
+  recordPackets: require('./lib/packet_recording').recordPackets,
+  createReplayClient: require('./lib/packet_recording').createReplayClient,
   supportedVersions,
   testedVersions
 }
@@ -63,12 +72,18 @@ function createBot (options = {}) {
     bot.on('error', err => console.log(err))
   }
 
-  pluginLoader(bot, options)
+  const pluginNames = new Map()
+  for (const key in plugins) pluginNames.set(plugins[key], key)
+  for (const key in options.plugins) {
+    if (typeof options.plugins[key] === 'function') pluginNames.set(options.plugins[key], key)
+  }
+  pluginLoader(bot, options, pluginNames)
   const internalPlugins = Object.keys(plugins)
     .filter(key => {
       if (typeof options.plugins[key] === 'function') return
       if (options.plugins[key] === false) return
-      return options.plugins[key] || options.loadInternalPlugins
+      if (options.plugins[key]) return true
+      return options.loadInternalPlugins && (!options.lean || leanPlugins.includes(key))
     }).map(key => plugins[key])
   const externalPlugins = Object.keys(options.plugins)
     .filter(key => {
@@ -88,7 +103,9 @@ class Bot extends EventEmitter {
 
   connect (options) {
     const self = this
-    self._client = mc.createClient(options)
+    // options.client replaces the connection, for example to drive the bot from recorded packets
+    self._client = options.client || mc.createClient(options)
+    if (options.coalesceWrites !== false) coalesceWrites(self._client)
     self.username = self._client.username
     self._client.on('session', () => {
       self.username = self._client.username
@@ -113,6 +130,7 @@ class Bot extends EventEmitter {
       self.majorVersion = version.majorVersion
       self.version = version.minecraftVersion
       options.version = version.minecraftVersion
+      if (options.lean) skipUnusedPackets(self._client, version.minecraftVersion)
       self.emit('inject_allowed')
     }
   }
@@ -0,0 +1,109 @@
+module.exports = loader
+
+const cache = {}
+
+function loader (mcVersion) {
+  if (!cache[mcVersion]) cache[mcVersion] = createBlockStates(mcVersion)
+  return cache[mcVersion]
+}
+
+/**
+ * Lookup tables from block state ids (as stored in chunk columns) to block
+ * properties, so hot paths can answer questions about a block without
+ * building a prismarine-block instance.
+ */
+function createBlockStates (mcVersion) {
+  const mcData = require('minecraft-data')(mcVersion)
+  const flattened = mcData.blocksArray.some(block => block.minStateId !== undefined)
+
+  let stateTypes = null
+  if (flattened) {
+    let maxStateId = 0
+    for (const block of mcData.blocksArray) {
+      if (block.maxStateId > maxStateId) maxStateId = block.maxStateId
+    }
+    stateTypes = new Int32Array(maxStateId + 1).fill(-1)
+    for (const block of mcData.blocksArray) {
+      for (let stateId = block.minStateId; stateId <= block.maxStateId; ++stateId) {
+        stateTypes[stateId] = block.id
+      }
+    }
+  }
+
+  let maxType = 0
+  for (const block of mcData.blocksArray) {
+    if (block.id > maxType) maxType = block.id
+  }
+  const solidTypes = new Uint8Array(maxType + 1)
+  const boxedTypes = new Uint8Array(maxType + 1)
+  for (const block of mcData.blocksArray) {
+    solidTypes[block.id] = block.boundingBox === 'block' ? 1 : 0
+    boxedTypes[block.id] = block.boundingBox !== 'empty' ? 1 : 0
+  }
+
+  /**
+   * Returns the block type (id in minecraft-data) of a state id
+   * @param  {Number} stateId
+   * @return {Number} -1 if the state id is unknown
+   */
+  function typeOf (stateId) {
+    if (!flattened) return stateId >> 4
+    return stateId < stateTypes.length ? stateTypes[stateId] : -1
+  }
+
+  /**
+   * Returns the metadata of a state id, always 0 for flattened versions
+   * @param  {Number} stateId
+   * @return {Number}
+   */
+  function metadataOf (stateId) {
+    return flattened ? 0 : stateId & 15
+  }
+
+  /**
+   * Returns true if the block has a full ("block") bounding box
+   * @param  {Number} stateId
+   * @return {Boolean}
+   */
+  function isSolid (stateId) {
+    const type = typeOf(stateId)
+    return type >= 0 && type < solidTypes.length && solidTypes[type] === 1
+  }
+
+  /**
+   * Returns true if the block stops rays: air, grass, flowers, torches... have
+   * an 'empty' bounding box and are seen through
+   * @param  {Number} stateId
+   * @return {Boolean}
+   */
+  function blocksSight (stateId) {
+    const type = typeOf(stateId)
+    return type >= 0 && type < boxedTypes.length && boxedTypes[type] === 1
+  }
+
+  /**
+   * Returns all the state ids a block type can have
+   * @param  {Number} type
+   * @return {Number[]}
+   */
+  function statesOf (type) {
+    const block = mcData.blocks[type]
+    if (!block) return []
+    const states = []
+    if (flattened) {
+      for (let stateId = block.minStateId; stateId <= block.maxStateId; ++stateId) states.push(stateId)
+    } else {
+      for (let metadata = 0; metadata < 16; ++metadata) states.push((type << 4) | metadata)
+    }
+    return states
+  }
+
+  return {
+    flattened,
+    typeOf,
+    metadataOf,
+    isSolid,
+    blocksSight,
+    statesOf
+  }
+}
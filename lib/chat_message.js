@@ -11,6 +11,125 @@ function loader (mcVersion) {
 
 var defaultLang
 
+// Supported constants @ 2014-04-21
+const supportedColors = [
+  'black',
+  'dark_blue',
+  'dark_green',
+  'dark_aqua',
+  'dark_red',
+  'dark_purple',
+  'gold',
+  'gray',
+  'dark_gray',
+  'blue',
+  'green',
+  'aqua',
+  'red',
+  'light_purple',
+  'yellow',
+  'white',
+  'obfuscated',
+  'bold',
+  'strikethrough',
+  'underlined',
+  'italic',
+  'reset'
+]
+const supportedClick = [
+  'open_url',
+  'open_file',
+  'run_command',
+  'suggest_command'
+]
+const supportedHover = [
+  'show_text',
+  'show_achievement',
+  'show_item',
+  'show_entity'
+]
+
+const motdCodes = {
+  color: {
+    black: '§0',
+    dark_blue: '§1',
+    dark_green: '§2',
+    dark_aqua: '§3',
+    dark_red: '§4',
+    dark_purple: '§5',
+    gold: '§6',
+    gray: '§7',
+    dark_gray: '§8',
+    blue: '§9',
+    green: '§a',
+    aqua: '§b',
+    red: '§c',
+    light_purple: '§d',
+    yellow: '§e',
+    white: '§f'
+  },
+  bold: '§l',
+  italic: '§o',
+  underlined: '§n',
+  strikethrough: '§m',
+  obfuscated: '§k'
+}
+
+const ansiCodes = {
+  '§0': '\u001b[30m',
+  '§1': '\u001b[34m',
+  '§2': '\u001b[32m',
+  '§3': '\u001b[36m',
+  '§4': '\u001b[31m',
+  '§5': '\u001b[35m',
+  '§6': '\u001b[33m',
+  '§7': '\u001b[37m',
+  '§8': '\u001b[90m',
+  '§9': '\u001b[94m',
+  '§a': '\u001b[92m',
+  '§b': '\u001b[96m',
+  '§c': '\u001b[91m',
+  '§d': '\u001b[95m',
+  '§e': '\u001b[93m',
+  '§f': '\u001b[97m',
+  '§l': '\u001b[1m',
+  '§o': '\u001b[3m',
+  '§n': '\u001b[4m',
+  '§m': '\u001b[9m',
+  '§k': '\u001b[6m',
+  '§r': '\u001b[0m'
+}
+const ansiCodesRegex = new RegExp(Object.keys(ansiCodes).join('|'), 'g')
+
+/**
+ * Defines with or extra as an own enumerable property of message, like the
+ * other parsed properties, whose ChatMessages are built from entries when first read:
+ * a malformed child only throws then
+ * @param {ChatMessage} message
+ * @param {String} name 'with' or 'extra'
+ * @param {Array} entries json of the children, undefined when they are assigned
+ */
+function defineChildren (message, name, entries) {
+  let built = entries === undefined
+  let children
+  Object.defineProperty(message, name, {
+    enumerable: true,
+    configurable: true,
+    get () {
+      if (!built) {
+        children = entries.map(entry => new ChatMessage(entry))
+        built = true
+      }
+      return children
+    },
+    set (value) {
+      children = value
+      built = true
+      message._rendered = null
+    }
+  })
+}
+
 /**
  * ChatMessage Constructor
  * @param {String|Object} message content of ChatMessage
@@ -24,16 +143,42 @@ class ChatMessage {
     } else {
       throw new Error('Expected String or Object for Message argument')
     }
+    // renderings of the message for this._renderedLang, see rendered()
+    Object.defineProperty(this, '_rendered', { value: null, writable: true })
+    Object.defineProperty(this, '_renderedLang', { value: null, writable: true })
     this.parse()
   }
 
+  // a message without with or extra gets them as own properties once assigned
+  get with () {
+    return undefined
+  }
+
+  set with (value) {
+    defineChildren(this, 'with', undefined)
+    this.with = value
+  }
+
+  get extra () {
+    return undefined
+  }
+
+  set extra (value) {
+    defineChildren(this, 'extra', undefined)
+    this.extra = value
+  }
+
   /**
    * Parses the this.json property to decorate the properties of the ChatMessage.
-   * Called by the Constructor
+   * Called by the Constructor. The with and extra children are parsed the
+   * first time they are read.
    * @return {void}
    */
   parse () {
     const json = this.json
+    this._rendered = null
+    delete this.with
+    delete this.extra
     // Message scope for callback functions
     // There is EITHER, a text property or a translate property
     // If there is no translate property, there is no with property
@@ -46,7 +191,7 @@ class ChatMessage {
         if (!Array.isArray(json.with)) {
           throw new Error('Expected with property to be an Array in ChatMessage')
         }
-        this.with = json.with.map(entry => new ChatMessage(entry))
+        defineChildren(this, 'with', json.with)
       }
     }
     // Parse extra property
@@ -55,7 +200,7 @@ class ChatMessage {
       if (!Array.isArray(json.extra)) {
         throw new Error('Expected extra property to be an Array in ChatMessage')
       }
-      this.extra = json.extra.map(entry => new ChatMessage(entry))
+      defineChildren(this, 'extra', json.extra)
     }
     // Text modifiers
     this.bold = json.bold
@@ -64,44 +209,6 @@ class ChatMessage {
     this.strikethrough = json.strikethrough
     this.obfuscated = json.obfuscated
 
-    // Supported constants @ 2014-04-21
-    const supportedColors = [
-      'black',
-      'dark_blue',
-      'dark_green',
-      'dark_aqua',
-      'dark_red',
-      'dark_purple',
-      'gold',
-      'gray',
-      'dark_gray',
-      'blue',
-      'green',
-      'aqua',
-      'red',
-      'light_purple',
-      'yellow',
-      'white',
-      'obfuscated',
-      'bold',
-      'strikethrough',
-      'underlined',
-      'italic',
-      'reset'
-    ]
-    const supportedClick = [
-      'open_url',
-      'open_file',
-      'run_command',
-      'suggest_command'
-    ]
-    const supportedHover = [
-      'show_text',
-      'show_achievement',
-      'show_item',
-      'show_entity'
-    ]
-
     // Parse color
     this.color = json.color
     switch (this.color) {
@@ -209,11 +316,31 @@ class ChatMessage {
     return ''
   }
 
+  /**
+   * Returns the cache of the string renderings of the message in lang.
+   * The message is not expected to change once rendered: parse() or setting
+   * with/extra clears it, changing other properties doesn't.
+   * @return {Object}
+   */
+  rendered (lang) {
+    if (this._rendered === null || this._renderedLang !== lang) {
+      this._rendered = { string: undefined, motd: undefined, ansi: undefined }
+      this._renderedLang = lang
+    }
+    return this._rendered
+  }
+
   /**
    * Flattens the message in to plain-text
    * @return {String}
    */
   toString (lang = defaultLang) {
+    const rendered = this.rendered(lang)
+    if (rendered.string === undefined) rendered.string = this.renderString(lang)
+    return rendered.string
+  }
+
+  renderString (lang) {
     let message = ''
     if (typeof this.text === 'string') message += this.text
     else if (this.with) {
@@ -233,32 +360,13 @@ class ChatMessage {
   }
 
   toMotd (lang = defaultLang) {
-    const codes = {
-      color: {
-        black: '§0',
-        dark_blue: '§1',
-        dark_green: '§2',
-        dark_aqua: '§3',
-        dark_red: '§4',
-        dark_purple: '§5',
-        gold: '§6',
-        gray: '§7',
-        dark_gray: '§8',
-        blue: '§9',
-        green: '§a',
-        aqua: '§b',
-        red: '§c',
-        light_purple: '§d',
-        yellow: '§e',
-        white: '§f'
-      },
-      bold: '§l',
-      italic: '§o',
-      underlined: '§n',
-      strikethrough: '§m',
-      obfuscated: '§k'
-    }
+    const rendered = this.rendered(lang)
+    if (rendered.motd === undefined) rendered.motd = this.renderMotd(lang)
+    return rendered.motd
+  }
 
+  renderMotd (lang) {
+    const codes = motdCodes
     let message = Object.keys(codes).map((code) => {
       if (!this[code] || this[code] === 'false') return null
       if (code === 'color') return codes.color[this.color]
@@ -278,36 +386,11 @@ class ChatMessage {
     return message
   }
 
-  toAnsi (lang) {
-    const codes = {
-      '§0': '\u001b[30m',
-      '§1': '\u001b[34m',
-      '§2': '\u001b[32m',
-      '§3': '\u001b[36m',
-      '§4': '\u001b[31m',
-      '§5': '\u001b[35m',
-      '§6': '\u001b[33m',
-      '§7': '\u001b[37m',
-      '§8': '\u001b[90m',
-      '§9': '\u001b[94m',
-      '§a': '\u001b[92m',
-      '§b': '\u001b[96m',
-      '§c': '\u001b[91m',
-      '§d': '\u001b[95m',
-      '§e': '\u001b[93m',
-      '§f': '\u001b[97m',
-      '§l': '\u001b[1m',
-      '§o': '\u001b[3m',
-      '§n': '\u001b[4m',
-      '§m': '\u001b[9m',
-      '§k': '\u001b[6m',
-      '§r': '\u001b[0m'
-    }
-
-    let message = this.toMotd(lang)
-    for (const k in codes) {
-      message = message.replace(new RegExp(k, 'g'), codes[k])
+  toAnsi (lang = defaultLang) {
+    const rendered = this.rendered(lang)
+    if (rendered.ansi === undefined) {
+      rendered.ansi = this.toMotd(lang).replace(ansiCodesRegex, code => ansiCodes[code])
     }
-    return message
+    return rendered.ansi
   }
 }
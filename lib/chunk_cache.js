@@ -0,0 +1,124 @@
+const fs = require('fs')
+const path = require('path')
+const { columnKey } = require('./chunk_sections')
+
+// start of every cache file, followed by a format version
+const MAGIC = 'MFCC'
+const FORMAT_VERSION = 2
+// magic, format version (u8), bit map (u16), sky light sent (u8), data length (u32)
+const HEADER_SIZE = 12
+// suffixes the files being written, so a column is never read half written
+let nextWriteId = 0
+
+/**
+ * On-disk copy of the chunk columns a bot had, to read before the server
+ * sends them again after a reconnect. There is one directory per server,
+ * version and dimension, holding one file per column: a small header followed
+ * by the data of column.dump(), as it would be received in map_chunk.
+ */
+class ChunkCache {
+  /**
+   * @param  {String} directory root of the cache
+   * @param  {String} server identifies the server, for example `${host}:${port}`
+   */
+  constructor (directory, server) {
+    this.root = path.join(directory, sanitize(server))
+    this.directory = null
+    // keys of the columns that have a file
+    this.keys = new Set()
+  }
+
+  // switches to the columns of that version and dimension
+  use (version, dimension) {
+    this.directory = path.join(this.root, sanitize(`${version}_${dimension}`))
+    this.keys.clear()
+    let files
+    try {
+      files = fs.readdirSync(this.directory)
+    } catch (err) {
+      return
+    }
+    for (const file of files) {
+      const match = /^(-?\d+)\.(-?\d+)\.bin$/.exec(file)
+      if (match) this.keys.add(columnKey(parseInt(match[1]), parseInt(match[2])))
+    }
+  }
+
+  has (key) {
+    return this.keys.has(key)
+  }
+
+  // forget about the file of that column for this session, its data is outdated
+  forget (key) {
+    this.keys.delete(key)
+  }
+
+  /**
+   * Reads the column at chunk coordinates (chunkX, chunkZ)
+   * @return {Object|null} { bitMap, skyLightSent, data } as addColumn takes them, null if it can't be read
+   * or isn't a whole column written by this version of the cache
+   */
+  read (chunkX, chunkZ) {
+    let buffer
+    try {
+      buffer = fs.readFileSync(this.file(chunkX, chunkZ))
+    } catch (err) {
+      return null
+    }
+    if (buffer.length < HEADER_SIZE || buffer.toString('latin1', 0, 4) !== MAGIC || buffer[4] !== FORMAT_VERSION) return null
+    if (buffer.readUInt32BE(8) !== buffer.length - HEADER_SIZE) return null
+    return {
+      bitMap: buffer.readUInt16BE(5),
+      skyLightSent: buffer[7] === 1,
+      data: buffer.slice(HEADER_SIZE)
+    }
+  }
+
+  // writes a decoded column in the background
+  writeColumn (chunkX, chunkZ, column, skyLightSent, cb) {
+    this.write(chunkX, chunkZ, {
+      // pre 1.9 columns always dump every section, with sky light
+      bitMap: typeof column.getMask === 'function' ? column.getMask() : 0xffff,
+      skyLightSent: skyLightSent || typeof column.getMask !== 'function',
+      data: column.dump()
+    }, cb)
+  }
+
+  // writes column data ({ bitMap, skyLightSent, data }) in the background, failures only mean it won't be cached
+  write (chunkX, chunkZ, { bitMap, skyLightSent, data }, cb = noop) {
+    if (this.directory === null) return cb()
+    const header = Buffer.alloc(HEADER_SIZE)
+    header.write(MAGIC, 0, 'latin1')
+    header[4] = FORMAT_VERSION
+    header.writeUInt16BE(bitMap & 0xffff, 5)
+    header[7] = skyLightSent ? 1 : 0
+    header.writeUInt32BE(data.length, 8)
+    const file = this.file(chunkX, chunkZ)
+    // written next to it then renamed, a crash can't leave a truncated column behind
+    const temporary = `${file}.${process.pid}-${nextWriteId++}.tmp`
+    fs.mkdir(this.directory, { recursive: true }, () => {
+      fs.writeFile(temporary, Buffer.concat([header, data]), (err) => {
+        if (err) return fs.unlink(temporary, () => cb())
+        fs.rename(temporary, file, () => cb())
+      })
+    })
+  }
+
+  // deletes the file of a column that couldn't be read
+  remove (chunkX, chunkZ) {
+    this.keys.delete(columnKey(chunkX, chunkZ))
+    fs.unlink(this.file(chunkX, chunkZ), noop)
+  }
+
+  file (chunkX, chunkZ) {
+    return path.join(this.directory, `${chunkX}.${chunkZ}.bin`)
+  }
+}
+
+function noop () {}
+
+function sanitize (name) {
+  return String(name).replace(/[^a-zA-Z0-9.-]/g, '_')
+}
+
+module.exports = ChunkCache
@@ -0,0 +1,150 @@
+const path = require('path')
+const { Vec3 } = require('vec3')
+const { SECTION_COUNT } = require('./chunk_sections')
+
+// version -> ChunkDecoder, the workers are shared by all the bots of the process
+const decoders = new Map()
+
+/**
+ * Pool of worker threads decoding map_chunk data into prismarine-chunk columns.
+ * The decoded column is structured-cloned back, which drops its prototypes, so
+ * they are restored from a column of the same class with every member created.
+ * A column whose shape isn't exactly the one of that template is refused, and
+ * decoded on the main thread instead.
+ */
+class ChunkDecoder {
+  constructor (version, workerCount) {
+    // required here, worker_threads needs node 10.5
+    this.Worker = require('worker_threads').Worker
+    this.version = version
+    this.workerCount = workerCount
+    this.workers = []
+    this.nextJobId = 0
+    this.template = createTemplate(version)
+  }
+
+  /**
+   * Decodes the column data of args ({ data, bitMap, skyLightSent }) in a worker
+   * @param  {Object} args
+   * @param  {Function} cb called with (err, column)
+   */
+  decode (args, cb) {
+    const worker = this.leastBusyWorker()
+    const jobId = this.nextJobId++
+    worker.jobs.set(jobId, cb)
+    // copied: the caller keeps args.data to decode it itself if it's needed sooner
+    const data = Uint8Array.from(args.data)
+    worker.postMessage({ jobId, data, bitMap: args.bitMap, skyLightSent: args.skyLightSent }, [data.buffer])
+  }
+
+  leastBusyWorker () {
+    if (this.workers.length < this.workerCount) {
+      const worker = new this.Worker(path.join(__dirname, 'chunk_decoder_worker.js'), { workerData: { version: this.version } })
+      worker.jobs = new Map()
+      worker.on('message', message => this.onDecoded(worker, message))
+      worker.on('error', err => this.onWorkerError(worker, err))
+      // a pool waiting for work doesn't keep the process alive
+      worker.unref()
+      this.workers.push(worker)
+      return worker
+    }
+    return this.workers.reduce((best, worker) => worker.jobs.size < best.jobs.size ? worker : best)
+  }
+
+  onDecoded (worker, { jobId, column, error }) {
+    const cb = worker.jobs.get(jobId)
+    worker.jobs.delete(jobId)
+    if (error) return cb(new Error(error))
+    let revived
+    try {
+      revived = revive(column, this.template)
+      // fails if the column couldn't be revived properly
+      revived.getBlockStateId(new Vec3(0, 0, 0))
+    } catch (err) {
+      return cb(err)
+    }
+    cb(null, revived)
+  }
+
+  onWorkerError (worker, err) {
+    this.workers.splice(this.workers.indexOf(worker), 1)
+    for (const cb of worker.jobs.values()) cb(err)
+    worker.jobs.clear()
+  }
+}
+
+// a column with all its sections and light arrays, to take the prototypes from
+function createTemplate (version) {
+  const Chunk = require('prismarine-chunk')(version)
+  const template = new Chunk()
+  const position = new Vec3(0, 0, 0)
+  for (let y = 0; y < SECTION_COUNT; y++) {
+    position.y = y * 16
+    template.setBlockStateId(position, 1)
+    template.setSkyLight(position, 15)
+    template.setBlockLight(position, 15)
+  }
+  return template
+}
+
+// gives value and what it contains the prototypes of template and what it contains,
+// throwing if they don't have the same members of the same kinds
+function revive (value, template, path = 'column') {
+  if (value === null || value === undefined) return value
+  if (typeof value !== 'object') {
+    if (template !== null && template !== undefined && typeof template !== typeof value) throw unexpected(path)
+    return value
+  }
+  if (template === null || typeof template !== 'object') throw unexpected(path)
+  if (ArrayBuffer.isView(value)) {
+    // structured cloning turns Buffers into Uint8Arrays
+    if (Buffer.isBuffer(template) && value instanceof Uint8Array) return Buffer.from(value.buffer, value.byteOffset, value.byteLength)
+    if (!ArrayBuffer.isView(template) || Buffer.isBuffer(template) || template.constructor !== value.constructor) throw unexpected(path)
+    return value
+  }
+  if (Array.isArray(value)) {
+    if (!Array.isArray(template)) throw unexpected(path)
+    // the template of the null items (empty sections) of template is any other item
+    const anyItem = template.find(item => item !== null && item !== undefined)
+    for (let i = 0; i < value.length; i++) {
+      value[i] = revive(value[i], template[i] !== null && template[i] !== undefined ? template[i] : anyItem, `${path}[${i}]`)
+    }
+    return value
+  }
+  if (value instanceof Map) {
+    if (!(template instanceof Map)) throw unexpected(path)
+    const anyItem = template.values().next().value
+    for (const [key, item] of value) value.set(key, revive(item, anyItem, `${path}.get(${key})`))
+    return value
+  }
+  if (ArrayBuffer.isView(template) || Array.isArray(template) || template instanceof Map) throw unexpected(path)
+  const keys = Object.keys(value)
+  const templateKeys = Object.keys(template)
+  if (keys.length !== templateKeys.length || templateKeys.some(key => !(key in value))) throw unexpected(path)
+  Object.setPrototypeOf(value, Object.getPrototypeOf(template))
+  for (const key of keys) value[key] = revive(value[key], template[key], `${path}.${key}`)
+  return value
+}
+
+function unexpected (path) {
+  return new Error(`the decoded chunk column doesn't have the expected shape at ${path}`)
+}
+
+/**
+ * @param  {String} version
+ * @param  {Number} workerCount workers of the pool, if it has to be created
+ * @return {ChunkDecoder} the decoder pool of that version
+ */
+function chunkDecoder (version, workerCount) {
+  let decoder = decoders.get(version)
+  if (!decoder) {
+    decoder = new ChunkDecoder(version, workerCount)
+    decoders.set(version, decoder)
+  }
+  return decoder
+}
+
+chunkDecoder.createTemplate = createTemplate
+chunkDecoder.revive = revive
+
+module.exports = chunkDecoder
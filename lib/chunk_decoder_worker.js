@@ -0,0 +1,33 @@
+// decodes map_chunk data for lib/chunk_decoder.js in a worker thread
+
+const { parentPort, workerData } = require('worker_threads')
+const Chunk = require('prismarine-chunk')(workerData.version)
+
+parentPort.on('message', ({ jobId, data, bitMap, skyLightSent }) => {
+  let column
+  try {
+    column = new Chunk()
+    column.load(Buffer.from(data.buffer, data.byteOffset, data.byteLength), bitMap, skyLightSent)
+  } catch (err) {
+    parentPort.postMessage({ jobId, error: err.message })
+    return
+  }
+  parentPort.postMessage({ jobId, column }, transferables(column))
+})
+
+// the array buffers of the column that can be moved instead of copied:
+// only those not shared with other views, like the pool of small Buffers
+function transferables (column) {
+  const buffers = new Set()
+  const visit = (value) => {
+    if (value === null || typeof value !== 'object') return
+    if (ArrayBuffer.isView(value)) {
+      if (value.byteOffset === 0 && value.byteLength === value.buffer.byteLength) buffers.add(value.buffer)
+      return
+    }
+    const items = value instanceof Map ? value.values() : Object.values(value)
+    for (const item of items) visit(item)
+  }
+  visit(column)
+  return Array.from(buffers)
+}
@@ -0,0 +1,48 @@
+// helpers to look inside the sections (16x16x16 cubes) of a prismarine-chunk column
+
+const SECTION_COUNT = 16
+
+exports.SECTION_COUNT = SECTION_COUNT
+exports.sectionPalette = sectionPalette
+exports.columnKey = columnKey
+exports.columnKeyChunkX = columnKeyChunkX
+exports.columnKeyChunkZ = columnKeyChunkZ
+exports.blockKey = blockKey
+
+// packs chunk coordinates in a single number, unique as long as |chunkZ| < 2^21
+// which covers the whole 30 million blocks wide minecraft world
+function columnKey (chunkX, chunkZ) {
+  return chunkX * 0x400000 + chunkZ
+}
+
+function columnKeyChunkX (key) {
+  return Math.floor((key + 0x200000) / 0x400000)
+}
+
+function columnKeyChunkZ (key) {
+  return key - columnKeyChunkX(key) * 0x400000
+}
+
+// packs the position of a block within its column in a single number
+function blockKey (x, y, z) {
+  return (y << 8) | ((z & 15) << 4) | (x & 15)
+}
+
+/**
+ * Returns the list of state ids a section may contain, or undefined if the
+ * chunk implementation doesn't expose it (pre 1.13 columns, or 1.13 sections
+ * that switched to the global palette) in which case the section has to be
+ * scanned block by block.
+ * @param  {Chunk} column
+ * @param  {Number} sectionY index of the section in the column (y >> 4)
+ * @return {Number[]|undefined}
+ */
+function sectionPalette (column, sectionY) {
+  if (!Array.isArray(column.sections)) return undefined
+  const section = column.sections[sectionY]
+  // sections that were never sent only contain air
+  if (!section) return [0]
+  if (typeof section.isEmpty === 'function' && section.isEmpty()) return [0]
+  if (Array.isArray(section.palette)) return section.palette
+  return undefined
+}
@@ -0,0 +1,25 @@
+module.exports = coalesceWrites
+
+/**
+ * Makes the packets written by the client within one turn of the event loop
+ * (a physics tick of the bot, a burst of window clicks...) go to the socket in
+ * a single write: the socket is corked on the first write and uncorked once the
+ * current callbacks are done.
+ * @param  {Client} client minecraft-protocol client
+ */
+function coalesceWrites (client) {
+  const write = client.write
+  let corkedSocket = null
+  client.write = function (name, params) {
+    const socket = this.socket
+    if (corkedSocket === null && socket && typeof socket.cork === 'function') {
+      corkedSocket = socket
+      socket.cork()
+      setImmediate(() => {
+        corkedSocket.uncork()
+        corkedSocket = null
+      })
+    }
+    return write.call(this, name, params)
+  }
+}
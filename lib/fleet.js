@@ -0,0 +1,149 @@
+const EventEmitter = require('events').EventEmitter
+const path = require('path')
+const os = require('os')
+const { FORWARDED_EVENTS, CALLBACK_POSITIONS, serialize, deserialize } = require('./fleet_protocol')
+
+/**
+ * Runs bots in worker threads so a process can use all its cores.
+ * Each bot is created in the worker with the fewest bots and controlled
+ * through a BotProxy.
+ */
+class Fleet extends EventEmitter {
+  constructor (options = {}) {
+    super()
+    // required here, worker_threads needs node 10.5
+    const { Worker } = require('worker_threads')
+    this.workers = []
+    this.bots = new Map()
+    this.nextBotId = 0
+    this.closing = false
+    const workerCount = options.workers || os.cpus().length
+    for (let i = 0; i < workerCount; i++) {
+      const worker = new Worker(path.join(__dirname, 'fleet_worker.js'), {
+        workerData: { shareWorld: options.shareWorld === true }
+      })
+      worker.botCount = 0
+      worker.on('message', message => this._onMessage(message))
+      worker.on('error', err => this.emit('error', err))
+      this.workers.push(worker)
+    }
+  }
+
+  /**
+   * Same as mineflayer.createBot, in a worker. options must be cloneable
+   * (no functions, so no external plugins and no world).
+   * @return {BotProxy}
+   */
+  createBot (options = {}) {
+    const worker = this.workers.reduce((best, worker) => worker.botCount < best.botCount ? worker : best)
+    const botId = this.nextBotId++
+    const bot = new BotProxy(worker, botId, options)
+    worker.botCount++
+    this.bots.set(botId, bot)
+    worker.postMessage({ type: 'create', botId, options })
+    return bot
+  }
+
+  // ends all the bots, each worker stops once its bots ended
+  close () {
+    this.closing = true
+    for (const bot of this.bots.values()) bot.end()
+    for (const worker of this.workers) {
+      if (worker.botCount === 0) worker.terminate()
+    }
+  }
+
+  _onMessage (message) {
+    const bot = this.bots.get(message.botId)
+    if (!bot) return
+    if (message.type === 'event') {
+      // the listener may have been removed while the event was on its way
+      if (bot.listenerCount(message.event) === 0) return
+      bot.emit(message.event, ...deserialize(message.args))
+    } else if (message.type === 'state') {
+      bot._updateState(message)
+    } else if (message.type === 'result') {
+      bot._onResult(message)
+    } else if (message.type === 'end') {
+      this.bots.delete(message.botId)
+      bot.worker.botCount--
+      bot.emit('end')
+      if (this.closing && bot.worker.botCount === 0) bot.worker.terminate()
+    }
+  }
+}
+
+// the methods of the bot the proxies have, everything else is available through bot.call
+const PROXIED_METHODS = [
+  'chat', 'whisper', 'quit', 'end',
+  'setControlState', 'clearControlStates', 'look', 'lookAt',
+  'blockAt', 'findBlock', 'dig', 'stopDigging', 'placeBlock', 'activateItem', 'deactivateItem',
+  'equip', 'toss', 'tossStack', 'attack', 'useOn', 'nearestEntity'
+]
+
+/**
+ * Stands for a bot running in a worker: forwards method calls and re-emits
+ * the events listed in lib/fleet_protocol.js, the worker only sends those
+ * the proxy has listeners for.
+ * Blocks, entities and results arrive as plain objects, with Vec3 positions.
+ */
+class BotProxy extends EventEmitter {
+  constructor (worker, botId, options) {
+    super()
+    this.worker = worker
+    this.botId = botId
+    this.username = options.username || 'Player'
+    this.entity = { position: null }
+    this.health = undefined
+    this.food = undefined
+    this.nextCallId = 0
+    this.pendingCalls = new Map()
+    this.on('newListener', (event) => {
+      if (FORWARDED_EVENTS.includes(event) && this.listenerCount(event) === 0) {
+        this.worker.postMessage({ type: 'subscribe', botId: this.botId, event })
+      }
+    })
+    this.on('removeListener', (event) => {
+      if (FORWARDED_EVENTS.includes(event) && this.listenerCount(event) === 0) {
+        this.worker.postMessage({ type: 'unsubscribe', botId: this.botId, event })
+      }
+    })
+  }
+
+  /**
+   * Calls bot[method](...args) in the worker. When the last argument is a
+   * function it is called back with (err, result) where the method would have
+   * called back, otherwise it's called with the return value of the method.
+   */
+  call (method, ...args) {
+    const cb = typeof args[args.length - 1] === 'function' ? args.pop() : noop
+    const callbackPosition = method in CALLBACK_POSITIONS ? CALLBACK_POSITIONS[method] : null
+    const callId = this.nextCallId++
+    this.pendingCalls.set(callId, cb)
+    this.worker.postMessage({ type: 'call', botId: this.botId, callId, method, args: args.map(arg => serialize(arg)), callbackPosition })
+  }
+
+  _onResult (message) {
+    const cb = this.pendingCalls.get(message.callId)
+    this.pendingCalls.delete(message.callId)
+    if (cb) cb(message.error ? new Error(message.error.message) : null, deserialize(message.result))
+  }
+
+  _updateState (message) {
+    this.username = message.username
+    this.entity.position = deserialize(message.position)
+    this.health = message.health
+    this.food = message.food
+  }
+}
+
+for (const method of PROXIED_METHODS) {
+  BotProxy.prototype[method] = function (...args) {
+    this.call(method, ...args)
+  }
+}
+
+function noop () {}
+
+module.exports = Fleet
+Fleet.BotProxy = BotProxy
@@ -0,0 +1,112 @@
+// what goes through the messages between a mineflayer.Fleet and its workers
+
+const { Vec3 } = require('vec3')
+
+// bot events re-emitted by the proxies, 'end' is handled on its own
+const FORWARDED_EVENTS = [
+  'login', 'spawn', 'death', 'kicked', 'error', 'health',
+  'chat', 'whisper', 'message',
+  'playerJoined', 'playerLeft',
+  'blockUpdate',
+  'entitySpawn', 'entityGone', 'entityMoved',
+  // with batchEntityEvents
+  'entitiesMoved', 'entitiesUpdated'
+]
+
+// index of the callback in the arguments of the proxied methods that call back
+const CALLBACK_POSITIONS = {
+  look: 3, // yaw, pitch, force, cb
+  lookAt: 2, // point, force, cb
+  dig: 1, // block, cb
+  placeBlock: 2, // referenceBlock, faceVector, cb
+  equip: 2, // item, destination, cb
+  toss: 3, // itemType, metadata, count, cb
+  tossStack: 1 // item, cb
+}
+
+// how deep plain objects are copied, deeper values are dropped
+const MAX_DEPTH = 3
+
+/**
+ * Turns values of the bot (Vec3, Block, Entity, ChatMessage, Error...) into values
+ * that can be posted, tagged with a kind so they can be turned back by deserialize.
+ * Functions are dropped.
+ */
+function serialize (value, depth = 0) {
+  if (value === null || value === undefined) return value
+  if (typeof value === 'function') return undefined
+  if (typeof value !== 'object') return value
+  if (value instanceof Error) return { kind: 'error', message: value.message }
+  if (value instanceof Vec3) return { kind: 'vec3', x: value.x, y: value.y, z: value.z }
+  if (Array.isArray(value)) return depth >= MAX_DEPTH ? undefined : value.map(item => serialize(item, depth + 1))
+  if (value.constructor && value.constructor.name === 'Entity' && 'id' in value) {
+    return {
+      kind: 'entity',
+      id: value.id,
+      type: value.type,
+      name: value.name,
+      username: value.username,
+      position: serialize(value.position)
+    }
+  }
+  if (value.constructor && value.constructor.name === 'Block' && value.position) {
+    return {
+      kind: 'block',
+      type: value.type,
+      name: value.name,
+      metadata: value.metadata,
+      position: serialize(value.position)
+    }
+  }
+  if (typeof value.toAnsi === 'function') return { kind: 'message', text: value.toString(), json: value.json }
+  if (depth >= MAX_DEPTH) return undefined
+  const copy = {}
+  for (const key of Object.keys(value)) {
+    const item = serialize(value[key], depth + 1)
+    if (item !== undefined) copy[key] = item
+  }
+  return copy
+}
+
+/**
+ * Turns back what serialize returned. resolve(value) can replace the tagged
+ * blocks and entities, by default they stay plain objects with a Vec3 position.
+ */
+function deserialize (value, resolve = value => value) {
+  if (value === null || typeof value !== 'object') return value
+  if (Array.isArray(value)) return value.map(item => deserialize(item, resolve))
+  switch (value.kind) {
+    case 'vec3': return new Vec3(value.x, value.y, value.z)
+    case 'error': return new Error(value.message)
+    case 'message': return Object.assign({ toString: () => value.text }, value)
+    case 'block':
+    case 'entity':
+      return resolve(Object.assign({}, value, { position: deserialize(value.position) }))
+  }
+  const copy = {}
+  for (const key of Object.keys(value)) copy[key] = deserialize(value[key], resolve)
+  return copy
+}
+
+/**
+ * The arguments to call a method with so cb is where it expects its callback,
+ * the optional arguments that were left out being undefined
+ * @param  {Array} args
+ * @param  {Number} position index of the callback argument, see CALLBACK_POSITIONS
+ * @param  {Function} cb
+ * @return {Array}
+ */
+function withCallback (args, position, cb) {
+  const padded = args.slice(0, position)
+  while (padded.length < position) padded.push(undefined)
+  padded.push(cb)
+  return padded
+}
+
+module.exports = {
+  FORWARDED_EVENTS,
+  CALLBACK_POSITIONS,
+  withCallback,
+  serialize,
+  deserialize
+}
@@ -0,0 +1,93 @@
+// runs the bots of a mineflayer.Fleet in a worker thread, see lib/fleet.js
+
+const { parentPort, workerData } = require('worker_threads')
+const mineflayer = require('../index')
+const { FORWARDED_EVENTS, serialize, deserialize, withCallback } = require('./fleet_protocol')
+
+const bots = new Map()
+const world = workerData.shareWorld ? new mineflayer.World() : undefined
+
+// how often at most the position of a moving bot is sent to its proxy
+const STATE_INTERVAL_MS = 100
+
+parentPort.on('message', (message) => {
+  if (message.type === 'create') create(message.botId, message.options)
+  else if (message.type === 'subscribe') subscribe(message.botId, message.event)
+  else if (message.type === 'unsubscribe') unsubscribe(message.botId, message.event)
+  else if (message.type === 'call') call(message.botId, message.callId, message.method, message.args, message.callbackPosition)
+})
+
+function create (botId, options) {
+  if (world && !options.world) options.world = world
+  const bot = mineflayer.createBot(options)
+  bots.set(botId, bot)
+  // event -> listener, only for the events the proxy listens to
+  bot.forwarded = new Map()
+  // the proxy mirrors the state the bot has after these events
+  let sentPosition = null
+  let stateTimer = null
+  const sendState = () => {
+    clearTimeout(stateTimer)
+    stateTimer = null
+    sentPosition = bot.entity ? bot.entity.position.clone() : null
+    parentPort.postMessage({
+      type: 'state',
+      botId,
+      username: bot.username,
+      position: serialize(sentPosition),
+      health: bot.health,
+      food: bot.food
+    })
+  }
+  bot.on('login', sendState)
+  bot.on('health', sendState)
+  bot.on('move', () => {
+    if (stateTimer !== null || (sentPosition !== null && sentPosition.equals(bot.entity.position))) return
+    stateTimer = setTimeout(sendState, STATE_INTERVAL_MS)
+  })
+  bot.on('end', () => {
+    clearTimeout(stateTimer)
+    bots.delete(botId)
+    parentPort.postMessage({ type: 'end', botId })
+  })
+}
+
+function subscribe (botId, event) {
+  const bot = bots.get(botId)
+  if (!bot || !FORWARDED_EVENTS.includes(event) || bot.forwarded.has(event)) return
+  const listener = (...args) => {
+    parentPort.postMessage({ type: 'event', botId, event, args: args.map(arg => serialize(arg)) })
+  }
+  bot.forwarded.set(event, listener)
+  bot.on(event, listener)
+}
+
+function unsubscribe (botId, event) {
+  const bot = bots.get(botId)
+  if (!bot || !bot.forwarded.has(event)) return
+  bot.removeListener(event, bot.forwarded.get(event))
+  bot.forwarded.delete(event)
+}
+
+function call (botId, callId, method, args, callbackPosition) {
+  const bot = bots.get(botId)
+  const reply = (err, result) => {
+    parentPort.postMessage({
+      type: 'result',
+      botId,
+      callId,
+      error: err ? { message: err.message || String(err) } : null,
+      result: serialize(result)
+    })
+  }
+  if (!bot || typeof bot[method] !== 'function') return reply(new Error(`bot.${method} is not a function`))
+  // blocks and entities are passed by position and id, use the worker's own objects
+  const resolve = value => value.kind === 'block' ? bot.blockAt(value.position) : bot.entities[value.id]
+  args = deserialize(args, resolve)
+  try {
+    if (callbackPosition !== null) bot[method](...withCallback(args, callbackPosition, reply))
+    else reply(null, bot[method](...args))
+  } catch (err) {
+    reply(err)
+  }
+}
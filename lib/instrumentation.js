@@ -0,0 +1,164 @@
+const { performance } = require('perf_hooks')
+
+module.exports = instrument
+
+// number of the latest durations kept per handler to compute percentiles
+const SAMPLE_COUNT = 1024
+
+const LISTENER_METHODS = ['on', 'addListener', 'prependListener']
+const ONCE_METHODS = { once: 'on', prependOnceListener: 'prependListener' }
+
+// the events named after a position or an id (blockUpdate:(x, y, z), setSlot:1, confirmTransaction12...)
+// share the stats of their prefix, there would be no end to them otherwise
+function eventKey (event) {
+  return String(event).replace(/:.*$|\d+$/, '')
+}
+
+/**
+ * Times every listener added to the bot and to its client, attributed to the
+ * plugin that added it: the plugin being injected, or the plugin whose listener
+ * was running when it was added. Durations exclude the listeners run by nested emits.
+ * @param  {Bot} bot
+ * @return {Object} { attachClient(client), setPlugin(name), stats(), resetStats() }
+ */
+function instrument (bot) {
+  // plugin name -> Map(`${source}:${event}` -> handler stats)
+  const plugins = new Map()
+  // the plugin adding listeners right now, null for user code
+  let currentPlugin = null
+  // one frame per listener running, to subtract the time of nested listeners
+  const running = []
+
+  function handlerStats (plugin, key) {
+    if (!plugins.has(plugin)) plugins.set(plugin, new Map())
+    const handlers = plugins.get(plugin)
+    let stats = handlers.get(key)
+    if (!stats) {
+      stats = { calls: 0, totalMs: 0, maxMs: 0, samples: new Float64Array(SAMPLE_COUNT) }
+      handlers.set(key, stats)
+    }
+    return stats
+  }
+
+  function wrap (source, event, listener) {
+    const plugin = currentPlugin === null ? '(user)' : currentPlugin
+    const stats = handlerStats(plugin, `${source}:${eventKey(event)}`)
+    function timed (...args) {
+      const frame = { nestedMs: 0 }
+      running.push(frame)
+      const previousPlugin = currentPlugin
+      currentPlugin = plugin
+      const start = performance.now()
+      try {
+        return listener.apply(this, args)
+      } finally {
+        const elapsed = performance.now() - start
+        currentPlugin = previousPlugin
+        running.pop()
+        if (running.length > 0) running[running.length - 1].nestedMs += elapsed
+        const ms = elapsed - frame.nestedMs
+        stats.samples[stats.calls % SAMPLE_COUNT] = ms
+        stats.calls++
+        stats.totalMs += ms
+        if (ms > stats.maxMs) stats.maxMs = ms
+      }
+    }
+    // lets removeListener(event, listener) find it, see EventEmitter
+    timed.listener = listener
+    return timed
+  }
+
+  function patch (emitter, source) {
+    const originals = {}
+    for (const method of LISTENER_METHODS) {
+      const original = originals[method] = emitter[method]
+      emitter[method] = function (event, listener) {
+        return original.call(this, event, wrap(source, event, listener))
+      }
+    }
+    for (const method in ONCE_METHODS) {
+      const add = originals[ONCE_METHODS[method]]
+      emitter[method] = function (event, listener) {
+        const timed = wrap(source, event, listener)
+        const emitter = this
+        function fired (...args) {
+          emitter.removeListener(event, fired)
+          return timed.apply(this, args)
+        }
+        fired.listener = listener
+        return add.call(this, event, fired)
+      }
+    }
+  }
+
+  function summarize (handlers) {
+    let calls = 0
+    let totalMs = 0
+    let maxMs = 0
+    const samples = []
+    for (const handler of handlers) {
+      calls += handler.calls
+      totalMs += handler.totalMs
+      maxMs = Math.max(maxMs, handler.maxMs)
+      samples.push(...handler.samples.subarray(0, Math.min(handler.calls, SAMPLE_COUNT)))
+    }
+    samples.sort((a, b) => a - b)
+    return {
+      calls,
+      totalMs,
+      meanMs: calls === 0 ? 0 : totalMs / calls,
+      p99Ms: samples.length === 0 ? 0 : samples[Math.min(samples.length - 1, Math.floor(samples.length * 0.99))],
+      maxMs
+    }
+  }
+
+  /**
+   * @return {Object} { plugins: { name: { calls, totalMs, handlers: { 'client:map_chunk': summary } } },
+   * packets: { map_chunk: summary } } where a summary is { calls, totalMs, meanMs, p99Ms, maxMs },
+   * the packet summaries merging the handlers of all the plugins
+   */
+  function stats () {
+    const result = { plugins: {}, packets: {} }
+    // packet name -> handler stats of every plugin
+    const packets = new Map()
+    for (const [plugin, handlers] of plugins) {
+      const pluginResult = { calls: 0, totalMs: 0, handlers: {} }
+      for (const [key, handler] of handlers) {
+        if (handler.calls === 0) continue
+        pluginResult.handlers[key] = summarize([handler])
+        pluginResult.calls += handler.calls
+        pluginResult.totalMs += handler.totalMs
+        if (!key.startsWith('client:')) continue
+        const name = key.slice('client:'.length)
+        if (!packets.has(name)) packets.set(name, [])
+        packets.get(name).push(handler)
+      }
+      if (pluginResult.calls > 0) result.plugins[plugin] = pluginResult
+    }
+    for (const [name, handlers] of packets) result.packets[name] = summarize(handlers)
+    return result
+  }
+
+  function resetStats () {
+    for (const handlers of plugins.values()) {
+      for (const handler of handlers.values()) {
+        handler.calls = 0
+        handler.totalMs = 0
+        handler.maxMs = 0
+      }
+    }
+  }
+
+  function setPlugin (name) {
+    currentPlugin = name
+  }
+
+  patch(bot, 'bot')
+
+  return {
+    attachClient (client) { patch(client, 'client') },
+    setPlugin,
+    stats,
+    resetStats
+  }
+}
@@ -0,0 +1,110 @@
+module.exports = indexWindow
+
+/**
+ * Makes the item lookups of a prismarine-windows window (count, countRange,
+ * findInventoryItem, findItemRange) use an index of its slots by item type
+ * instead of scanning every slot.
+ * The index is built on the first lookup, then the slots that change are moved
+ * in it by wrapping updateSlot and acceptClick (that changes the clicked slot in place).
+ * @param  {Window} window
+ * @param  {Number} inventorySlotCount number of slots of the player inventory part of the window
+ * @return {Window} the same window
+ */
+function indexWindow (window, inventorySlotCount) {
+  if (!window || window.itemIndex) return window
+
+  // item type -> slots holding that type, in increasing order. null until the first lookup
+  let slotsByType = null
+  // slot -> the item type it's indexed under, null for empty
+  let indexedTypes = null
+
+  function build () {
+    slotsByType = new Map()
+    indexedTypes = window.slots.map((item, slot) => {
+      if (!item) return null
+      if (!slotsByType.has(item.type)) slotsByType.set(item.type, [])
+      slotsByType.get(item.type).push(slot)
+      return item.type
+    })
+  }
+
+  function slotsOf (itemType) {
+    if (slotsByType === null) build()
+    return slotsByType.get(itemType) || []
+  }
+
+  // moves the slot to the list of the type it holds now
+  function reindex (slot) {
+    if (slotsByType === null || !(slot >= 0 && slot < window.slots.length)) return
+    const item = window.slots[slot]
+    const type = item ? item.type : null
+    const oldType = indexedTypes[slot]
+    if (type === oldType) return
+    indexedTypes[slot] = type
+    if (oldType !== null && oldType !== undefined) {
+      const slots = slotsByType.get(oldType)
+      slots.splice(slots.indexOf(slot), 1)
+      if (slots.length === 0) slotsByType.delete(oldType)
+    }
+    if (type !== null) {
+      if (!slotsByType.has(type)) slotsByType.set(type, [])
+      const slots = slotsByType.get(type)
+      let i = slots.length
+      while (i > 0 && slots[i - 1] > slot) --i
+      slots.splice(i, 0, slot)
+    }
+  }
+
+  // for changes made to window.slots directly: the index is built again on the next lookup
+  function invalidate () {
+    slotsByType = null
+    indexedTypes = null
+  }
+
+  const updateSlot = window.updateSlot
+  window.updateSlot = function (slot, newItem) {
+    const result = updateSlot.call(this, slot, newItem)
+    reindex(slot)
+    return result
+  }
+
+  // the cursor item isn't in a slot, only the clicked slot has to be moved
+  const acceptClick = window.acceptClick
+  window.acceptClick = function (click) {
+    const result = acceptClick.call(this, click)
+    reindex(click.slot)
+    return result
+  }
+
+  window.findItemRange = function (start, end, itemType, metadata, notFull) {
+    for (const slot of slotsOf(itemType)) {
+      if (slot < start || slot >= end) continue
+      const item = this.slots[slot]
+      if (metadata != null && item.metadata !== metadata) continue
+      if (notFull && item.count >= item.stackSize) continue
+      return item
+    }
+    return null
+  }
+
+  window.findInventoryItem = function (itemType, metadata, notFull) {
+    return this.findItemRange(this.inventorySlotStart, this.inventorySlotStart + inventorySlotCount, itemType, metadata, notFull)
+  }
+
+  window.countRange = function (start, end, itemType, metadata) {
+    let sum = 0
+    for (const slot of slotsOf(itemType)) {
+      if (slot < start || slot >= end) continue
+      const item = this.slots[slot]
+      if (metadata == null || item.metadata === metadata) sum += item.count
+    }
+    return sum
+  }
+
+  window.count = function (itemType, metadata) {
+    return this.countRange(this.inventorySlotStart, this.inventorySlotStart + inventorySlotCount, itemType, metadata)
+  }
+
+  window.itemIndex = { invalidate }
+  return window
+}
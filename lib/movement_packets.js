@@ -0,0 +1,27 @@
+// like the vanilla client, the position is only sent when it moved more than 0.03 blocks
+const MIN_POSITION_DELTA_SQUARED = 0.03 * 0.03
+
+/**
+ * The packet telling the server what changed since lastSent, like the vanilla client picks it
+ * @param  {Object} lastSent { x, y, z, yaw, pitch, onGround } what the server was last told
+ * @param  {Object} state { x, y, z, yaw, pitch, onGround } the current one, yaw and pitch in degrees
+ * @param  {Boolean} refresh send the position even if it didn't move
+ * @return {String|null} 'position_look', 'position', 'look', 'flying' or null when nothing changed
+ */
+function movementPacketName (lastSent, state, refresh) {
+  const dx = state.x - lastSent.x
+  const dy = state.y - lastSent.y
+  const dz = state.z - lastSent.z
+  const moved = refresh || dx * dx + dy * dy + dz * dz > MIN_POSITION_DELTA_SQUARED
+  const rotated = state.yaw !== lastSent.yaw || state.pitch !== lastSent.pitch
+  if (moved && rotated) return 'position_look'
+  if (moved) return 'position'
+  if (rotated) return 'look'
+  if (state.onGround !== lastSent.onGround) return 'flying'
+  return null
+}
+
+module.exports = {
+  MIN_POSITION_DELTA_SQUARED,
+  movementPacketName
+}
@@ -0,0 +1,63 @@
+module.exports = skipUnusedPackets
+
+/**
+ * Makes the client only deserialize the play packets something listens to.
+ * The others are only read up to their id and emitted with empty params, which
+ * nobody sees since they have no listener. Everything is still parsed while
+ * something listens to 'packet' or 'raw'.
+ * @param  {Client} client minecraft-protocol client
+ * @param  {String} version minecraft version of the client
+ */
+function skipUnusedPackets (client, version) {
+  const names = packetNames(require('minecraft-data')(version))
+  if (names === null) return
+
+  function filter () {
+    const deserializer = client.deserializer
+    if (client.state !== 'play' || !deserializer || deserializer.skipsUnusedPackets) return
+    const parsePacketBuffer = deserializer.parsePacketBuffer
+    deserializer.parsePacketBuffer = function (buffer) {
+      const name = names[readVarInt(buffer)]
+      if (name === undefined || isUsed(name)) return parsePacketBuffer.call(this, buffer)
+      return {
+        data: { name, params: {} },
+        metadata: { size: buffer.length },
+        buffer,
+        fullBuffer: buffer
+      }
+    }
+    deserializer.skipsUnusedPackets = true
+  }
+
+  function isUsed (name) {
+    return client.listenerCount(name) > 0 || client.listenerCount('packet') > 0 ||
+      client.listenerCount('raw') > 0 || client.listenerCount('raw.' + name) > 0
+  }
+
+  // the deserializer is replaced when the state changes
+  client.on('state', filter)
+  filter()
+}
+
+// packet id -> name of the play packets sent by the server, null if the protocol is not understood
+function packetNames (mcData) {
+  try {
+    const nameField = mcData.protocol.play.toClient.types.packet[1].find(field => field.name === 'name')
+    const mappings = nameField.type[1].mappings
+    const names = []
+    for (const id in mappings) names[parseInt(id)] = mappings[id]
+    return names
+  } catch (err) {
+    return null
+  }
+}
+
+// the varint at the start of the buffer, -1 if it isn't complete
+function readVarInt (buffer) {
+  let value = 0
+  for (let offset = 0; offset < 5 && offset < buffer.length; offset++) {
+    value |= (buffer[offset] & 0x7f) << (7 * offset)
+    if ((buffer[offset] & 0x80) === 0) return value
+  }
+  return -1
+}
@@ -0,0 +1,118 @@
+const fs = require('fs')
+const EventEmitter = require('events').EventEmitter
+const { performance } = require('perf_hooks')
+
+// start of a recording, followed by the format version and the minecraft version
+const MAGIC = 'MFPR'
+const FORMAT_VERSION = 1
+// before each packet: its length (u32) and when it was received, in ms since the start (u32)
+const RECORD_HEADER_SIZE = 8
+
+/**
+ * Writes the play packets the bot receives to a file, as they came from the server.
+ * @param  {Bot} bot
+ * @param  {String} file
+ * @return {Object} { stop(cb) } stop ends the recording, cb is called once it's written
+ */
+function recordPackets (bot, file) {
+  const client = bot._client
+  const out = fs.createWriteStream(file)
+  const version = Buffer.from(client.version || bot.version, 'utf8')
+  const header = Buffer.alloc(MAGIC.length + 2)
+  header.write(MAGIC, 0, 'latin1')
+  header[4] = FORMAT_VERSION
+  header[5] = version.length
+  out.write(Buffer.concat([header, version]))
+  const start = performance.now()
+
+  function onRaw (buffer, metadata) {
+    if (metadata.state !== 'play') return
+    const recordHeader = Buffer.alloc(RECORD_HEADER_SIZE)
+    recordHeader.writeUInt32BE(buffer.length, 0)
+    recordHeader.writeUInt32BE(Math.round(performance.now() - start), 4)
+    out.write(Buffer.concat([recordHeader, buffer]))
+  }
+
+  function stop (cb) {
+    client.removeListener('raw', onRaw)
+    client.removeListener('end', stop)
+    out.end(cb)
+  }
+
+  client.on('raw', onRaw)
+  client.on('end', stop)
+  return { stop }
+}
+
+/**
+ * A client for the client option of createBot, emitting the packets of a recording
+ * instead of connecting to a server. What the bot writes is dropped.
+ * It starts once the bot is created, emits "replayEnd" after the last packet and then ends.
+ * @param  {String} file written by recordPackets
+ * @param  {Object} options { speed } 1 (the default) replays at the recorded pace,
+ * 2 twice as fast... Infinity as fast as possible
+ * @return {EventEmitter} the client
+ */
+function createReplayClient (file, { speed = 1 } = {}) {
+  const data = fs.readFileSync(file)
+  if (data.toString('latin1', 0, MAGIC.length) !== MAGIC || data[4] !== FORMAT_VERSION) {
+    throw new Error(`${file} is not a packet recording`)
+  }
+  const versionEnd = MAGIC.length + 2 + data[5]
+  const client = new EventEmitter()
+  client.version = data.toString('utf8', MAGIC.length + 2, versionEnd)
+  client.username = 'replay'
+  client.state = 'play'
+  client.ended = false
+  client.write = () => {}
+  client.end = () => {
+    if (client.ended) return
+    client.ended = true
+    client.emit('end')
+  }
+
+  const deserializer = require('minecraft-protocol').createDeserializer({ state: 'play', isServer: false, version: client.version })
+  let offset = versionEnd
+  const start = performance.now()
+
+  function emitPacket (buffer) {
+    const parsed = deserializer.parsePacketBuffer(buffer)
+    const metadata = { name: parsed.data.name, state: 'play', size: buffer.length }
+    client.emit('packet', parsed.data.params, metadata, buffer, buffer)
+    client.emit(metadata.name, parsed.data.params, metadata)
+    client.emit('raw.' + metadata.name, buffer, metadata)
+    client.emit('raw', buffer, metadata)
+  }
+
+  // emits the packets that are due, then waits until the next one is
+  function replay () {
+    // as fast as possible still lets the timers and callbacks of the bot run between batches
+    let batch = 0
+    while (!client.ended && offset < data.length) {
+      const length = data.readUInt32BE(offset)
+      const time = data.readUInt32BE(offset + 4)
+      const wait = time / speed - (performance.now() - start)
+      if (wait > 0) return setTimeout(replay, wait)
+      if (++batch > 1000) return setImmediate(replay)
+      offset += RECORD_HEADER_SIZE
+      try {
+        emitPacket(data.slice(offset, offset + length))
+      } catch (err) {
+        client.emit('error', err)
+      }
+      offset += length
+    }
+    if (client.ended) return
+    client.emit('replayEnd')
+    client.end()
+  }
+
+  // the bot plugins listen once createBot returned
+  setImmediate(replay)
+  return client
+}
+
+module.exports = {
+  recordPackets,
+  createReplayClient
+}
@@ -1,20 +1,24 @@
 const assert = require('assert')
+const instrument = require('./instrumentation')
 
 module.exports = inject
 
-function inject (bot, options) {
+// pluginNames: plugin function -> name it is reported under by bot.stats()
+function inject (bot, options, pluginNames = new Map()) {
   let loaded = false
   let pluginsToBeAdded = []
+  const instrumentation = options.instrument ? instrument(bot) : null
   bot.once('inject_allowed', onInjectAllowed)
 
   function onInjectAllowed () {
     loaded = true
+    if (instrumentation) instrumentation.attachClient(bot._client)
     injectPlugins(pluginsToBeAdded)
   }
   function loadPlugin (plugin) {
     assert.ok(typeof plugin === 'function', 'plugin needs to be a function')
     if (!loaded) pluginsToBeAdded.push(plugin)
-    else plugin(bot, options)
+    else injectPlugin(plugin)
   }
   function loadPlugins (plugins) {
     assert.ok(plugins.filter(plugin => typeof plugin === 'function').length === plugins.length, 'plugins need to be an array of functions')
@@ -22,11 +26,30 @@ function inject (bot, options) {
     pluginsToBeAdded = pluginsToBeAdded.concat(plugins)
   }
   function injectPlugins (plugins) {
-    plugins.forEach((plugin) => {
+    plugins.forEach(injectPlugin)
+  }
+  function injectPlugin (plugin) {
+    if (!instrumentation) return plugin(bot, options)
+    instrumentation.setPlugin(pluginNames.get(plugin) || plugin.name || '(anonymous)')
+    try {
       plugin(bot, options)
-    })
+    } finally {
+      instrumentation.setPlugin(null)
+    }
+  }
+
+  function stats () {
+    assert.ok(instrumentation, 'bot.stats() needs the instrument option of createBot')
+    return instrumentation.stats()
+  }
+
+  function resetStats () {
+    assert.ok(instrumentation, 'bot.resetStats() needs the instrument option of createBot')
+    instrumentation.resetStats()
   }
 
   bot.loadPlugin = loadPlugin
   bot.loadPlugins = loadPlugins
+  bot.stats = stats
+  bot.resetStats = resetStats
 }
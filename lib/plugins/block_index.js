@@ -0,0 +1,174 @@
+const Vec3 = require('vec3').Vec3
+const { SECTION_COUNT, sectionPalette, columnKey } = require('../chunk_sections')
+
+module.exports = inject
+
+// keeps the positions of the block types listed in options.indexedBlocks
+// up to date, so finding them doesn't require scanning the world
+function inject (bot, { version, indexedBlocks }) {
+  if (!indexedBlocks || indexedBlocks.length === 0) return
+
+  const mcData = require('minecraft-data')(version)
+  const blockStates = require('../block_states')(version)
+
+  const types = new Set(indexedBlocks.map((block) => {
+    if (typeof block === 'number') return block
+    const blockData = mcData.blocksByName[block]
+    if (!blockData) throw new Error(`indexedBlocks: unknown block ${block}`)
+    return blockData.id
+  }))
+  // type -> Map(column key -> { chunkX, chunkZ, positions: Set of packed positions in the column })
+  const index = new Map()
+  for (const type of types) index.set(type, new Map())
+  // columns loaded but not indexed yet: column key -> corner. They are indexed by the first
+  // query that needs them, so a lazily loaded column isn't decoded just for the index
+  const unindexed = new Map()
+
+  const cursor = new Vec3(0, 0, 0)
+
+  function add (type, x, y, z) {
+    const columns = index.get(type)
+    if (!columns) return
+    const chunkX = x >> 4
+    const chunkZ = z >> 4
+    const key = columnKey(chunkX, chunkZ)
+    let entry = columns.get(key)
+    if (!entry) {
+      entry = { chunkX, chunkZ, positions: new Set() }
+      columns.set(key, entry)
+    }
+    entry.positions.add(packLocal(x & 15, y, z & 15))
+  }
+
+  function remove (type, x, y, z) {
+    const columns = index.get(type)
+    if (!columns) return
+    const key = columnKey(x >> 4, z >> 4)
+    const entry = columns.get(key)
+    if (!entry) return
+    entry.positions.delete(packLocal(x & 15, y, z & 15))
+    if (entry.positions.size === 0) columns.delete(key)
+  }
+
+  function dropColumn (chunkX, chunkZ) {
+    const key = columnKey(chunkX, chunkZ)
+    for (const columns of index.values()) columns.delete(key)
+  }
+
+  function indexColumn (corner) {
+    const chunkX = Math.floor(corner.x / 16)
+    const chunkZ = Math.floor(corner.z / 16)
+    const column = bot._chunkColumn(corner.x, corner.z)
+    if (!column) return
+    for (let sectionY = 0; sectionY < SECTION_COUNT; ++sectionY) {
+      const palette = sectionPalette(column, sectionY)
+      if (palette !== undefined && !palette.some(stateId => types.has(blockStates.typeOf(stateId)))) continue
+      const baseY = sectionY * 16
+      for (let y = baseY; y < baseY + 16; ++y) {
+        for (let z = 0; z < 16; ++z) {
+          for (let x = 0; x < 16; ++x) {
+            cursor.set(x, y, z)
+            const type = blockStates.typeOf(column.getBlockStateId(cursor))
+            if (types.has(type)) add(type, chunkX * 16 + x, y, chunkZ * 16 + z)
+          }
+        }
+      }
+    }
+  }
+
+  // indexes the pending columns within maxDistance of point, all of them without point
+  function indexPending (point, maxDistanceSquared) {
+    for (const [key, corner] of unindexed) {
+      if (point) {
+        const dx = Math.max(corner.x - point.x, 0, point.x - (corner.x + 15))
+        const dz = Math.max(corner.z - point.z, 0, point.z - (corner.z + 15))
+        if (dx * dx + dz * dz > maxDistanceSquared) continue
+      }
+      unindexed.delete(key)
+      indexColumn(corner)
+    }
+  }
+
+  function find ({ matching, point, maxDistance = 16, count = 1 }) {
+    point = point || bot.entity.position
+    const maxDistanceSquared = maxDistance * maxDistance
+    if (unindexed.size !== 0) indexPending(point, maxDistanceSquared)
+    const found = []
+    for (const type of (Array.isArray(matching) ? matching : [matching])) {
+      const columns = index.get(type)
+      if (!columns) continue
+      for (const { chunkX, chunkZ, positions } of columns.values()) {
+        const dx = Math.max(chunkX * 16 - point.x, 0, point.x - (chunkX * 16 + 15))
+        const dz = Math.max(chunkZ * 16 - point.z, 0, point.z - (chunkZ * 16 + 15))
+        if (dx * dx + dz * dz > maxDistanceSquared) continue
+        for (const packed of positions) {
+          const x = chunkX * 16 + (packed & 15)
+          const y = packed >> 8
+          const z = chunkZ * 16 + ((packed >> 4) & 15)
+          const distanceSquared = (x - point.x) * (x - point.x) + (y - point.y) * (y - point.y) + (z - point.z) * (z - point.z)
+          if (distanceSquared <= maxDistanceSquared) found.push({ x, y, z, distanceSquared })
+        }
+      }
+    }
+    found.sort((a, b) => a.distanceSquared - b.distanceSquared)
+    return found.slice(0, count).map(({ x, y, z }) => new Vec3(x, y, z))
+  }
+
+  function covers (matching) {
+    if (typeof matching === 'function') return false
+    return (Array.isArray(matching) ? matching : [matching]).every(type => types.has(type))
+  }
+
+  function positions (type) {
+    if (unindexed.size !== 0) indexPending(null)
+    const columns = index.get(type)
+    if (!columns) return []
+    const result = []
+    for (const { chunkX, chunkZ, positions } of columns.values()) {
+      for (const packed of positions) {
+        result.push(new Vec3(chunkX * 16 + (packed & 15), packed >> 8, chunkZ * 16 + ((packed >> 4) & 15)))
+      }
+    }
+    return result
+  }
+
+  bot.on('chunkColumnLoad', (corner) => {
+    const chunkX = Math.floor(corner.x / 16)
+    const chunkZ = Math.floor(corner.z / 16)
+    // the whole column may have been resent, start over for it
+    dropColumn(chunkX, chunkZ)
+    unindexed.set(columnKey(chunkX, chunkZ), corner)
+  })
+
+  bot.on('chunkColumnUnload', (corner) => {
+    const chunkX = Math.floor(corner.x / 16)
+    const chunkZ = Math.floor(corner.z / 16)
+    dropColumn(chunkX, chunkZ)
+    unindexed.delete(columnKey(chunkX, chunkZ))
+  })
+
+  // the old state of the batch can't be trusted: with a shared world, another bot may
+  // have applied the change to the column already, so it's compared to what this index has
+  bot.on('blockUpdateBatch', (changes) => {
+    for (let i = 0; i < changes.length; i += 5) {
+      // the column will be read as it is when it's indexed
+      if (unindexed.size !== 0 && unindexed.has(columnKey(changes[i] >> 4, changes[i + 2] >> 4))) continue
+      const newType = blockStates.typeOf(changes[i + 4])
+      for (const type of types) {
+        if (type !== newType) remove(type, changes[i], changes[i + 1], changes[i + 2])
+      }
+      add(newType, changes[i], changes[i + 1], changes[i + 2])
+    }
+  })
+
+  bot.blockIndex = {
+    types,
+    covers,
+    find,
+    positions
+  }
+}
+
+function packLocal (x, y, z) {
+  return (y << 8) | (z << 4) | x
+}
@@ -2,7 +2,11 @@ const vec3 = require('vec3')
 const Vec3 = vec3.Vec3
 const assert = require('assert')
 const Painting = require('../painting')
-const Location = require('../location')
+const World = require('../world')
+const raycast = require('../raycast')
+const chunkDecoder = require('../chunk_decoder')
+const ChunkCache = require('../chunk_cache')
+const { SECTION_COUNT, sectionPalette, columnKey, columnKeyChunkX, columnKeyChunkZ, blockKey } = require('../chunk_sections')
 
 module.exports = inject
 
@@ -13,178 +17,510 @@ const paintingFaceToVec = [
   new Vec3(1, 0, 0)
 ]
 
-function inject (bot, { version }) {
+function inject (bot, { version, host, port, lazyChunkLoading, chunkWorkers, chunkCache, maxColumns, chunkMemoryLimit, world = new World() }) {
   const nbt = require('prismarine-nbt')
   const Chunk = require('prismarine-chunk')(version)
   const ChatMessage = require('../chat_message')(version)
-  let columns = {}
-  const signs = {}
-  const paintingsByPos = {}
+  const blockStates = require('../block_states')(version)
+  // storage of the current dimension, possibly shared with other bots, see World
+  let store
+  let columns
+  let pendingColumns
+  let signs
+  let blockEntities
+  // column key -> approximate memory used by that column, in bytes
+  // this has an entry for every column this bot holds in the store, decoded or pending
+  const columnSizes = new Map()
+  let columnBytes = 0
+  // reused by the coordinate based lookups so they don't allocate
+  const chunkCursor = new Vec3(0, 0, 0)
+  // column key -> Map(block key -> painting), see blockKey
+  const paintingsByPos = new Map()
   const paintingsById = {}
-
-  const blockEntities = new Map()
+  // with chunkWorkers, the full columns decoded in a worker stay pending until they are decoded
+  const decoder = chunkWorkers && !lazyChunkLoading ? chunkDecoder(version, chunkWorkers) : null
+  // column key -> pending list of the last decoding sent for that column
+  const decodings = new Map()
+  // with chunkCache, the columns of the last session are read from there until the server sends them
+  const cache = chunkCache ? new ChunkCache(chunkCache, `${host || 'localhost'}:${port || 25565}`) : null
+  // whether the columns of the current dimension have sky light, to write them to the cache
+  let skyLightSent = true
+
+  function useStore (dimension) {
+    store = world.store(version, dimension)
+    columns = store.columns
+    pendingColumns = store.pendingColumns
+    signs = store.signs
+    blockEntities = store.blockEntities
+    bot._columns = columns
+    bot._blockEntities = blockEntities
+    if (cache) cache.use(version, dimension)
+  }
+  useStore(0)
 
   function addPainting (painting) {
     paintingsById[painting.id] = painting
-    paintingsByPos[painting.position] = painting
+    setEntry(paintingsByPos, painting.position.x, painting.position.y, painting.position.z, painting)
   }
 
   function deletePainting (painting) {
     delete paintingsById[painting.id]
-    delete paintingsByPos[painting.position]
+    deleteEntry(paintingsByPos, painting.position.x, painting.position.y, painting.position.z)
   }
 
+  // block entities are kept as simplified nbt, sign lines as received until something reads them
   function addBlockEntity (nbtData) {
     const blockEntity = nbt.simplify(nbtData)
-    const absolutePoint = new Vec3(blockEntity.x, blockEntity.y, blockEntity.z)
-    const loc = new Location(absolutePoint)
+    const { x, y, z } = blockEntity
+    setEntry(blockEntities, x, y, z, blockEntity)
+    if (isSign(blockEntity)) {
+      setEntry(signs, x, y, z, { lines: [blockEntity.Text1, blockEntity.Text2, blockEntity.Text3, blockEntity.Text4], parse: parseBlockEntityLine, text: undefined })
+    }
+  }
 
-    // Handle signs
-    if (blockEntity.id === 'minecraft:sign' || blockEntity.id === 'Sign') {
-      const prepareJson = (i) => {
-        const data = blockEntity[`Text${i}`]
+  // the sign text of the block entity, as it's given in the nbt
+  function parseBlockEntityLine (data) {
+    if (data === '' || data === undefined) return new ChatMessage('')
+    const json = JSON.parse(data)
+    if (!('text' in json)) return new ChatMessage('')
+    json.text = json.text.replace(/^"|"$/g, '')
+    return new ChatMessage(json)
+  }
 
-        if (data === '') return ''
+  // the sign text of update_sign
+  function parseUpdateSignLine (text) {
+    if (text === 'null' || text === '') text = '""'
+    const json = JSON.parse(text)
+    if (json.text) json.text = json.text.replace(/^"|"$/g, '')
+    return new ChatMessage(json)
+  }
 
-        const json = JSON.parse(data)
-        if (!('text' in json)) return ''
+  function signTextAt (x, y, z) {
+    const sign = entryAt(signs, x, y, z)
+    if (sign === undefined) return undefined
+    if (sign.text === undefined) sign.text = sign.lines.map(line => sign.parse(line).toString()).join('\n')
+    return sign.text
+  }
 
-        json.text = json.text.replace(/^"|"$/g, '')
-        return json
+  function blockEntityAt (x, y, z) {
+    const blockEntity = entryAt(blockEntities, x, y, z)
+    // the lines become ChatMessages the first time the sign is read
+    if (blockEntity !== undefined && isSign(blockEntity) && !(blockEntity.Text1 instanceof ChatMessage)) {
+      for (const line of ['Text1', 'Text2', 'Text3', 'Text4']) blockEntity[line] = parseBlockEntityLine(blockEntity[line])
+    }
+    return blockEntity
+  }
+
+  // the paintings of the column go away with it, its block entities and signs are freed by the store
+  function deleteColumnEntries (key) {
+    const paintings = paintingsByPos.get(key)
+    if (paintings !== undefined) {
+      for (const painting of paintings.values()) delete paintingsById[painting.id]
+      paintingsByPos.delete(key)
+    }
+  }
+
+  function delColumn (chunkX, chunkZ) {
+    const columnCorner = new Vec3(chunkX * 16, 0, chunkZ * 16)
+    decodings.delete(columnKey(chunkX, chunkZ))
+    cacheColumn(columnKey(chunkX, chunkZ))
+    deleteColumnEntries(columnKey(chunkX, chunkZ))
+    setColumnSize(columnKey(chunkX, chunkZ), 0)
+    bot.emit('chunkColumnUnload', columnCorner)
+  }
+
+  // a size of 0 releases the column: the store frees it when no other bot holds it
+  function setColumnSize (key, size) {
+    const held = columnSizes.has(key)
+    columnBytes += size - (columnSizes.get(key) || 0)
+    if (size === 0) {
+      columnSizes.delete(key)
+      // don't release the hold of another bot on a column we never had
+      if (held || !store.isHeld(key)) store.release(key)
+    } else {
+      columnSizes.set(key, size)
+      if (!held) {
+        store.acquire(key)
+        orderForEviction(key)
       }
+    }
+  }
 
-      blockEntity.Text1 = new ChatMessage(prepareJson(1))
-      blockEntity.Text2 = new ChatMessage(prepareJson(2))
-      blockEntity.Text3 = new ChatMessage(prepareJson(3))
-      blockEntity.Text4 = new ChatMessage(prepareJson(4))
-
-      signs[loc.floored] = [
-        blockEntity.Text1.toString(),
-        blockEntity.Text2.toString(),
-        blockEntity.Text3.toString(),
-        blockEntity.Text4.toString()
-      ].join('\n')
+  function releaseAllColumns () {
+    decodings.clear()
+    for (const key of columnSizes.keys()) {
+      cacheColumn(key)
+      store.release(key)
     }
+    columnSizes.clear()
+    evictionOrder = null
+    columnBytes = 0
+  }
 
-    blockEntities[loc.floored] = blockEntity
+  function overColumnLimits () {
+    return (maxColumns !== undefined && columnSizes.size > maxColumns) ||
+      (chunkMemoryLimit !== undefined && columnBytes > chunkMemoryLimit)
   }
 
-  function delColumn (chunkX, chunkY) {
-    const columnCorner = new Vec3(chunkX * 16, 0, chunkY * 16)
-    const key = columnKeyXZ(columnCorner.x, columnCorner.z)
-    delete columns[key]
-    bot.emit('chunkColumnUnload', columnCorner)
+  // the columns are only evicted once the server told where the bot is
+  let positionKnown = false
+  // keys of the loaded columns, nearest to the column (evictionChunkX, evictionChunkZ) first.
+  // null until needed and when the bot changed column. It may still have unloaded keys,
+  // they are skipped
+  let evictionOrder = null
+  let evictionChunkX = 0
+  let evictionChunkZ = 0
+
+  function evictionDistance (key) {
+    const dx = columnKeyChunkX(key) - evictionChunkX
+    const dz = columnKeyChunkZ(key) - evictionChunkZ
+    return dx * dx + dz * dz
   }
 
-  function addColumn (args) {
-    const columnCorner = new Vec3(args.x * 16, 0, args.z * 16)
-    const key = columnKeyXZ(columnCorner.x, columnCorner.z)
-    if (!args.bitMap) {
-      // stop storing the chunk column
-      delColumn(args.x, args.z)
+  // adds a newly loaded column to evictionOrder, where it belongs
+  function orderForEviction (key) {
+    if (evictionOrder === null) return
+    const distance = evictionDistance(key)
+    let low = 0
+    let high = evictionOrder.length
+    while (low < high) {
+      const middle = (low + high) >> 1
+      if (evictionDistance(evictionOrder[middle]) <= distance) low = middle + 1
+      else high = middle
+    }
+    evictionOrder.splice(low, 0, key)
+  }
+
+  // unload the columns farthest from the bot until we are within maxColumns and chunkMemoryLimit
+  function evictColumns () {
+    if (!positionKnown) return
+    const chunkX = Math.floor(bot.entity.position.x / 16)
+    const chunkZ = Math.floor(bot.entity.position.z / 16)
+    if (evictionOrder === null || chunkX !== evictionChunkX || chunkZ !== evictionChunkZ || evictionOrder.length > 2 * columnSizes.size) {
+      evictionChunkX = chunkX
+      evictionChunkZ = chunkZ
+      evictionOrder = Array.from(columnSizes.keys())
+      evictionOrder.sort((a, b) => evictionDistance(a) - evictionDistance(b))
+    }
+    while (overColumnLimits() && evictionOrder.length > 0) {
+      const key = evictionOrder.pop()
+      if (columnSizes.has(key)) delColumn(columnKeyChunkX(key), columnKeyChunkZ(key))
+    }
+  }
+
+  bot.on('forcedMove', () => {
+    if (positionKnown) return
+    positionKnown = true
+    // what was received before
+    if (overColumnLimits()) evictColumns()
+  })
+
+  // writes the column to the cache, as received if it was not decoded yet
+  function cacheColumn (key) {
+    if (!cache) return
+    const chunkX = columnKeyChunkX(key)
+    const chunkZ = columnKeyChunkZ(key)
+    const pending = pendingColumns.get(key)
+    if (pending !== undefined) {
+      if (pending.length === 1 && pending[0].groundUp) cache.write(chunkX, chunkZ, pending[0])
       return
     }
-    let column = columns[key]
-    if (!column) columns[key] = column = new Chunk()
+    const column = columns.get(key)
+    if (column) cache.writeColumn(chunkX, chunkZ, column, skyLightSent)
+  }
+
+  // reads the column from the cache, undefined if it's not there
+  function loadCachedColumn (key) {
+    cache.forget(key)
+    const args = cache.read(columnKeyChunkX(key), columnKeyChunkZ(key))
+    if (args === null || !loadColumn(key, args)) {
+      // a bad file would fail again next session
+      cache.remove(columnKeyChunkX(key), columnKeyChunkZ(key))
+      columns.delete(key)
+      return undefined
+    }
+    setColumnSize(key, args.data.length)
+    return columns.get(key)
+  }
+
+  function chunkMemoryUsage () {
+    return {
+      columns: columnSizes.size,
+      pendingColumns: pendingColumns.size,
+      bytes: columnBytes
+    }
+  }
+
+  function loadColumn (key, args) {
+    let column = columns.get(key)
+    if (!column) {
+      column = new Chunk()
+      columns.set(key, column)
+    }
 
     try {
       column.load(args.data, args.bitMap, args.skyLightSent)
     } catch (e) {
       bot.emit('error', e)
+      return false
+    }
+    return true
+  }
+
+  function addColumn (args) {
+    const columnCorner = new Vec3(args.x * 16, 0, args.z * 16)
+    const key = columnKey(args.x, args.z)
+    // what the server sends replaces the cached column
+    if (cache) cache.forget(key)
+    skyLightSent = args.skyLightSent
+    if (!args.bitMap) {
+      // stop storing the chunk column
+      delColumn(args.x, args.z)
       return
     }
 
-    bot.emit('chunkColumnLoad', columnCorner)
+    // when another bot sharing this world already has the column, it keeps it up to date for us
+    const alreadyShared = args.groundUp && !columnSizes.has(key) && store.isHeld(key)
+    if (alreadyShared) {
+      // nothing to decode
+    } else if (lazyChunkLoading || (decoder && (args.groundUp || pendingColumns.has(key)))) {
+      const pending = pendingColumns.get(key)
+      if (args.groundUp || !pending) {
+        // a full column replaces whatever was waiting to be loaded
+        pendingColumns.set(key, [args])
+      } else {
+        pending.push(args)
+      }
+    } else if (!loadColumn(key, args)) {
+      return
+    }
+    // the decoded column takes about as much memory as its network representation
+    setColumnSize(key, args.groundUp ? args.data.length : Math.max(columnSizes.get(key) || 0, args.data.length))
+
+    if (decoder && !alreadyShared && args.groundUp) {
+      // chunkColumnLoad is emitted once it's decoded
+      decodeInWorker(key, columnCorner, pendingColumns.get(key))
+    } else {
+      bot.emit('chunkColumnLoad', columnCorner)
+    }
+    if (overColumnLimits()) evictColumns()
   }
 
-  function findBlock (options) {
-    let check
-    if (typeof (options.matching) !== 'function') {
-      if (!Array.isArray(options.matching)) {
-        options.matching = [options.matching]
+  function decodeInWorker (key, columnCorner, pending) {
+    decodings.set(key, pending)
+    decoder.decode(pending[0], (err, column) => {
+      // dropped if the column was unloaded or a newer full column was received
+      if (decodings.get(key) !== pending) return
+      decodings.delete(key)
+      // otherwise it was decoded on demand by getColumn meanwhile
+      if (pendingColumns.get(key) === pending) {
+        if (err) {
+          // decoded here instead
+          getColumn(key)
+        } else {
+          pendingColumns.delete(key)
+          columns.set(key, column)
+          for (const args of pending.slice(1)) {
+            if (!loadColumn(key, args)) {
+              columns.delete(key)
+              break
+            }
+          }
+        }
       }
-      check = isMatchingType
-    } else check = options.matching
-    options.point = options.point || bot.entity.position
-    options.maxDistance = options.maxDistance || 16
-    const cursor = vec3()
-    const point = options.point
-    const max = options.maxDistance
-    let found
-    for (cursor.x = point.x - max; cursor.x < point.x + max; cursor.x++) {
-      for (cursor.y = point.y - max; cursor.y < point.y + max; cursor.y++) {
-        for (cursor.z = point.z - max; cursor.z < point.z + max; cursor.z++) {
-          found = bot.blockAt(cursor)
-          if (check(found)) return found
+      bot.emit('chunkColumnLoad', columnCorner)
+    })
+  }
+
+  // returns the column for that key, loading it first if it's pending
+  function getColumn (key) {
+    if (pendingColumns.size !== 0) {
+      const pending = pendingColumns.get(key)
+      if (pending !== undefined) {
+        pendingColumns.delete(key)
+        for (const args of pending) {
+          if (!loadColumn(key, args)) {
+            columns.delete(key)
+            setColumnSize(key, 0)
+            return undefined
+          }
         }
       }
     }
-    return null
+    const column = columns.get(key)
+    if (column === undefined && cache !== null && cache.has(key)) return loadCachedColumn(key)
+    return column
+  }
 
-    function isMatchingType (block) {
-      return block === null ? false : options.matching.indexOf(block.type) >= 0
+  function createStateMatcher (options) {
+    if (typeof options.matching !== 'function') {
+      const types = new Set(Array.isArray(options.matching) ? options.matching : [options.matching])
+      const matchesState = (stateId) => types.has(blockStates.typeOf(stateId))
+      return {
+        matches: matchesState,
+        mayMatchPalette: (palette) => palette.some(matchesState)
+      }
+    }
+    const matching = options.matching
+    if (options.useExtraInfo !== false) {
+      // the matcher may look at the position, sign text, block entity...
+      // so it has to see every block
+      return {
+        matches: (stateId, x, y, z) => !!matching(blockAtXYZ(x, y, z)),
+        mayMatchPalette: () => true
+      }
+    }
+    // the matcher only depends on the block state: remember its answer per state id
+    const memo = new Map()
+    return {
+      matches: (stateId, x, y, z) => {
+        let result = memo.get(stateId)
+        if (result === undefined) {
+          result = !!matching(blockAtXYZ(x, y, z))
+          memo.set(stateId, result)
+        }
+        return result
+      },
+      mayMatchPalette: (palette) => palette.some(stateId => memo.get(stateId) !== false)
     }
   }
 
-  function posInChunk (pos) {
-    return pos.floored().modulus(new Vec3(16, 256, 16))
+  function findBlocks (options) {
+    // the block index plugin already knows where these are
+    if (bot.blockIndex && bot.blockIndex.covers(options.matching)) return bot.blockIndex.find(options)
+
+    const matcher = createStateMatcher(options)
+    const point = options.point || bot.entity.position
+    const maxDistance = options.maxDistance || 16
+    const count = options.count || 1
+    const maxDistanceSquared = maxDistance * maxDistance
+
+    // every loaded section intersecting the search sphere, nearest first
+    const sections = []
+    const minChunkX = Math.floor((point.x - maxDistance) / 16)
+    const maxChunkX = Math.floor((point.x + maxDistance) / 16)
+    const minChunkZ = Math.floor((point.z - maxDistance) / 16)
+    const maxChunkZ = Math.floor((point.z + maxDistance) / 16)
+    for (let chunkX = minChunkX; chunkX <= maxChunkX; ++chunkX) {
+      for (let chunkZ = minChunkZ; chunkZ <= maxChunkZ; ++chunkZ) {
+        const column = getColumn(columnKey(chunkX, chunkZ))
+        if (!column) continue
+        for (let sectionY = 0; sectionY < SECTION_COUNT; ++sectionY) {
+          const distanceSquared = distanceSquaredToBox(point, chunkX * 16, sectionY * 16, chunkZ * 16, 15)
+          if (distanceSquared <= maxDistanceSquared) {
+            sections.push({ column, chunkX, chunkZ, sectionY, distanceSquared })
+          }
+        }
+      }
+    }
+    sections.sort((a, b) => a.distanceSquared - b.distanceSquared)
+
+    let found = []
+    for (const { column, chunkX, chunkZ, sectionY, distanceSquared } of sections) {
+      // nothing in this section, or any further one, can beat what we have
+      if (found.length >= count && distanceSquared > found[found.length - 1].distanceSquared) break
+      const palette = sectionPalette(column, sectionY)
+      if (palette !== undefined && !matcher.mayMatchPalette(palette)) continue
+
+      const baseX = chunkX * 16
+      const baseY = sectionY * 16
+      const baseZ = chunkZ * 16
+      for (let y = 0; y < 16; ++y) {
+        for (let z = 0; z < 16; ++z) {
+          for (let x = 0; x < 16; ++x) {
+            const dx = baseX + x - point.x
+            const dy = baseY + y - point.y
+            const dz = baseZ + z - point.z
+            const blockDistanceSquared = dx * dx + dy * dy + dz * dz
+            if (blockDistanceSquared > maxDistanceSquared) continue
+            chunkCursor.set(x, baseY + y, z)
+            const stateId = column.getBlockStateId(chunkCursor)
+            if (matcher.matches(stateId, baseX + x, baseY + y, baseZ + z)) {
+              found.push({ x: baseX + x, y: baseY + y, z: baseZ + z, distanceSquared: blockDistanceSquared })
+            }
+          }
+        }
+      }
+      // keep the nearest count sorted, so the last one is the farthest the early exit compares to
+      if (found.length >= count) {
+        found.sort((a, b) => a.distanceSquared - b.distanceSquared)
+        if (found.length > count) found = found.slice(0, count)
+      }
+    }
+    found.sort((a, b) => a.distanceSquared - b.distanceSquared)
+    return found.slice(0, count).map(({ x, y, z }) => new Vec3(x, y, z))
   }
 
-  function blockAt (absolutePoint) {
-    const loc = new Location(absolutePoint)
-    const key = columnKeyXZ(loc.chunkCorner.x, loc.chunkCorner.z)
+  function findBlock (options) {
+    const positions = findBlocks(Object.assign({}, options, { count: 1 }))
+    return positions.length === 0 ? null : blockAt(positions[0])
+  }
+
+  // returns the column containing the floored point (x, z), without allocating
+  function columnAt (x, z) {
+    return getColumn(columnKey(x >> 4, z >> 4))
+  }
 
-    const column = columns[key]
+  // returns the state id at the point (x, y, z) or null if it is not loaded
+  function blockStateAt (x, y, z) {
+    x = Math.floor(x)
+    y = Math.floor(y)
+    z = Math.floor(z)
+    if (y < 0 || y >= 256) return null
+    const column = columnAt(x, z)
+    // null column means chunk not loaded
+    if (!column) return null
+    chunkCursor.set(x & 15, y, z & 15)
+    return column.getBlockStateId(chunkCursor)
+  }
+
+  function blockAtXYZ (x, y, z) {
+    x = Math.floor(x)
+    y = Math.floor(y)
+    z = Math.floor(z)
+    if (y < 0 || y >= 256) return null
+    const column = columnAt(x, z)
     // null column means chunk not loaded
     if (!column) return null
 
-    const block = column.getBlock(posInChunk(absolutePoint))
-    block.position = loc.floored
-    block.signText = signs[loc.floored]
-    block.painting = paintingsByPos[loc.floored]
-    block.blockEntity = blockEntities[loc.floored]
+    const block = column.getBlock(new Vec3(x & 15, y, z & 15))
+    block.position = new Vec3(x, y, z)
+    block.signText = signTextAt(x, y, z)
+    block.painting = entryAt(paintingsByPos, x, y, z)
+    block.blockEntity = blockEntityAt(x, y, z)
 
     return block
   }
 
-  function blockIsNotEmpty (pos) {
-    const block = bot.blockAt(pos)
-    return block !== null && block.boundingBox !== 'empty'
-  }
-
-  // maybe this should be moved to math.js instead?
-  function visiblePosition (a, b) {
-    let v = b.minus(a)
-    const t = Math.sqrt(v.x * v.x + v.y * v.y + v.z * v.z)
-    v = v.scaled(1 / t)
-    v = v.scaled(1 / 5)
-    const u = t * 5
-    let na
-    for (let i = 1; i < u; i++) {
-      na = a.plus(v)
-      // check that blocks don't inhabit the same position
-      if (!na.floored().equals(a.floored())) {
-        // check block is not transparent
-        if (blockIsNotEmpty(na)) return false
-      }
-      a = na
-    }
-    return true
+  function blockAt (absolutePoint) {
+    return blockAtXYZ(absolutePoint.x, absolutePoint.y, absolutePoint.z)
   }
 
   // if passed in block is within line of sight to the bot, returns true
   // also works on anything with a position value
   function canSeeBlock (block) {
-    // this emits a ray from the center of the bots body to the block
-    if (visiblePosition(bot.entity.position.offset(0, bot.entity.height * 0.5, 0), block.position)) {
-      return true
-    }
-    return false
+    // this emits a ray from the center of the bots body to the center of the block
+    const from = bot.entity.position.offset(0, bot.entity.height * 0.5, 0)
+    const targetX = Math.floor(block.position.x)
+    const targetY = Math.floor(block.position.y)
+    const targetZ = Math.floor(block.position.z)
+    const startX = Math.floor(from.x)
+    const startY = Math.floor(from.y)
+    const startZ = Math.floor(from.z)
+    const direction = new Vec3(targetX + 0.5 - from.x, targetY + 0.5 - from.y, targetZ + 0.5 - from.z)
+    const distance = Math.sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z)
+    const hit = raycast(from, direction, distance, (x, y, z) => {
+      if (x === targetX && y === targetY && z === targetZ) return true
+      // the block the ray starts in doesn't hide anything
+      if (x === startX && y === startY && z === startZ) return false
+      const stateId = blockStateAt(x, y, z)
+      return stateId !== null && blockStates.blocksSight(stateId)
+    })
+    return hit !== null && hit.position.x === targetX && hit.position.y === targetY && hit.position.z === targetZ
   }
 
   function chunkColumn (x, z) {
-    const key = columnKeyXZ(x, z)
-    return columns[key]
+    return getColumn(columnKey(Math.floor(x / 16), Math.floor(z / 16)))
   }
 
   function emitBlockUpdate (oldBlock, newBlock) {
@@ -198,26 +534,45 @@ function inject (bot, { version }) {
     delColumn(packet.x, packet.z)
   })
 
-  function updateBlockState (point, stateId) {
-    const oldBlock = blockAt(point)
-    const loc = new Location(point)
-    const key = columnKeyXZ(loc.chunkCorner.x, loc.chunkCorner.z)
-    const column = columns[key]
-    // sometimes minecraft server sends us block updates before it sends
-    // us the column that the block is in. ignore this.
-    if (!column) return
-    column.setBlockStateId(posInChunk(point), stateId)
-
-    const newBlock = blockAt(point)
-    if (oldBlock.type !== newBlock.type) {
-      delete blockEntities[loc.floored]
-      delete signs[loc.floored]
-
-      const painting = paintingsByPos[loc.floored]
-      if (painting) deletePainting(painting)
+  function hasPositionBlockUpdateListeners () {
+    return bot.eventNames().some(name => typeof name === 'string' && name.startsWith('blockUpdate:'))
+  }
+
+  // changes is a flat list of x, y, z, stateId (integer coordinates)
+  function updateBlockStates (changes) {
+    // only build the Block instances if somebody wants them
+    const emitPerBlock = bot.listenerCount('blockUpdate') > 0 || hasPositionBlockUpdateListeners()
+    const batch = []
+    for (let i = 0; i < changes.length; i += 4) {
+      const x = changes[i]
+      const y = changes[i + 1]
+      const z = changes[i + 2]
+      const stateId = changes[i + 3]
+      const column = columnAt(x, z)
+      // sometimes minecraft server sends us block updates before it sends
+      // us the column that the block is in. ignore this.
+      if (!column || y < 0 || y >= 256) continue
+      const oldBlock = emitPerBlock ? blockAtXYZ(x, y, z) : null
+      chunkCursor.set(x & 15, y, z & 15)
+      const oldStateId = column.getBlockStateId(chunkCursor)
+      column.setBlockStateId(chunkCursor, stateId)
+
+      if (blockStates.typeOf(oldStateId) !== blockStates.typeOf(stateId)) {
+        deleteEntry(blockEntities, x, y, z)
+        deleteEntry(signs, x, y, z)
+
+        const painting = entryAt(paintingsByPos, x, y, z)
+        if (painting) deletePainting(painting)
+      }
+
+      batch.push(x, y, z, oldStateId, stateId)
+      if (emitPerBlock) emitBlockUpdate(oldBlock, blockAtXYZ(x, y, z))
     }
+    if (batch.length !== 0) bot.emit('blockUpdateBatch', Int32Array.from(batch))
+  }
 
-    emitBlockUpdate(oldBlock, newBlock)
+  function updateBlockState (point, stateId) {
+    updateBlockStates([Math.floor(point.x), Math.floor(point.y), Math.floor(point.z), stateId])
   }
 
   bot._client.on('map_chunk', (packet) => {
@@ -264,15 +619,16 @@ function inject (bot, { version }) {
 
   bot._client.on('multi_block_change', (packet) => {
     // multi block change
+    const changes = []
     for (let i = 0; i < packet.records.length; ++i) {
       const record = packet.records[i]
 
       const blockZ = (record.horizontalPos & 0x0f)
       const blockX = (record.horizontalPos >> 4) & 0x0f
 
-      const pt = new Vec3(packet.chunkX * 16 + blockX, record.y, packet.chunkZ * 16 + blockZ)
-      updateBlockState(pt, record.blockId)
+      changes.push(packet.chunkX * 16 + blockX, record.y, packet.chunkZ * 16 + blockZ, record.blockId)
     }
+    updateBlockStates(changes)
   })
 
   bot._client.on('block_change', (packet) => {
@@ -282,10 +638,11 @@ function inject (bot, { version }) {
 
   bot._client.on('explosion', (packet) => {
     // explosion
+    const changes = []
     packet.affectedBlockOffsets.forEach((offset) => {
-      const pt = vec3(offset).offset(packet.x, packet.y, packet.z)
-      updateBlockState(pt.floor(), 0)
+      changes.push(Math.floor(packet.x + offset.x), Math.floor(packet.y + offset.y), Math.floor(packet.z + offset.z), 0)
     })
+    updateBlockStates(changes)
   })
 
   bot._client.on('spawn_entity_painting', (packet) => {
@@ -307,27 +664,8 @@ function inject (bot, { version }) {
     const pos = new Vec3(packet.location.x, packet.location.y, packet.location.z)
     const oldBlock = blockAt(pos)
 
-    const prepareString = (i) => {
-      let text = packet[`text${i}`]
-
-      if (text === 'null' || text === '') {
-        text = '""'
-      }
-
-      const json = JSON.parse(text)
-      if (json.text) {
-        json.text = json.text.replace(/^"|"$/g, '')
-      }
-
-      return new ChatMessage(json)
-    }
-
-    signs[pos] = [
-      prepareString(1),
-      prepareString(2),
-      prepareString(3),
-      prepareString(4)
-    ].join('\n')
+    const lines = [packet.text1, packet.text2, packet.text3, packet.text4]
+    setEntry(signs, pos.x, pos.y, pos.z, { lines, parse: parseUpdateSignLine, text: undefined })
 
     emitBlockUpdate(oldBlock, blockAt(pos))
   })
@@ -363,24 +701,61 @@ function inject (bot, { version }) {
   let dimension
   bot._client.on('login', (packet) => {
     dimension = packet.dimension
+    useStore(dimension)
   })
   bot._client.on('respawn', (packet) => {
     if (dimension === packet.dimension) return
     dimension = packet.dimension
-    columns = {}
+    for (const key of Array.from(columnSizes.keys())) {
+      delColumn(columnKeyChunkX(key), columnKeyChunkZ(key))
+    }
+    useStore(dimension)
   })
+  bot.on('end', releaseAllColumns)
 
   bot.findBlock = findBlock
+  bot.findBlocks = findBlocks
   bot.canSeeBlock = canSeeBlock
   bot.blockAt = blockAt
+  bot.blockAtXYZ = blockAtXYZ
+  bot.blockStateAt = blockStateAt
+  bot.chunkMemoryUsage = chunkMemoryUsage
   bot._chunkColumn = chunkColumn
   bot._updateBlockState = updateBlockState
-  bot._columns = columns
-  bot._blockEntities = blockEntities
 }
 
-function columnKeyXZ (x, z) {
-  return `${x},${z}`
+function isSign (blockEntity) {
+  return blockEntity.id === 'minecraft:sign' || blockEntity.id === 'Sign'
+}
+
+// byColumn maps column keys to Map(block key -> value), see blockKey
+function entryAt (byColumn, x, y, z) {
+  const entries = byColumn.get(columnKey(x >> 4, z >> 4))
+  return entries === undefined ? undefined : entries.get(blockKey(x, y, z))
+}
+
+function setEntry (byColumn, x, y, z, value) {
+  const key = columnKey(x >> 4, z >> 4)
+  let entries = byColumn.get(key)
+  if (entries === undefined) {
+    entries = new Map()
+    byColumn.set(key, entries)
+  }
+  entries.set(blockKey(x, y, z), value)
+}
+
+function deleteEntry (byColumn, x, y, z) {
+  const key = columnKey(x >> 4, z >> 4)
+  const entries = byColumn.get(key)
+  if (entries !== undefined && entries.delete(blockKey(x, y, z)) && entries.size === 0) byColumn.delete(key)
+}
+
+// squared distance from point to the box going from (x, y, z) to (x + size, y + size, z + size)
+function distanceSquaredToBox (point, x, y, z, size) {
+  const dx = Math.max(x - point.x, 0, point.x - (x + size))
+  const dy = Math.max(y - point.y, 0, point.y - (y + size))
+  const dz = Math.max(z - point.z, 0, point.z - (z + size))
+  return dx * dx + dy * dy + dz * dz
 }
 
 function onesInShort (n) {
@@ -39,19 +39,29 @@ function inject (bot, options) {
     })
   }
 
+  // bot.chatPatterns compiled by compileChatPatterns, rebuilt when the list changes
+  let compiledPatterns = null
+
+  function chatPatternsMatcher () {
+    if (compiledPatterns === null || !compiledPatterns.compiledFrom(bot.chatPatterns)) {
+      compiledPatterns = compileChatPatterns(bot.chatPatterns)
+    }
+    return compiledPatterns
+  }
+
   bot._client.on('chat', (packet) => {
     function checkForChatPatterns (msg) {
       const stringMsg = msg.toString()
       let matchAny = false
-      // iterate through each object in chat.patterns array and test if .pattern matches
-      for (const { pattern, type } of bot.chatPatterns) {
-        // Chat pattern matches server messages so drop them
-        if (stringMsg.startsWith('[Server:')) break
-
-        const match = stringMsg.match(pattern)
-        if (match) {
-          matchAny = true
-          bot.emit(type, ...match.slice(1), msg.translate, msg)
+      // Chat pattern matches server messages so drop them
+      if (!stringMsg.startsWith('[Server:')) {
+        // the patterns that can match, in the order of bot.chatPatterns
+        for (const { pattern, type } of chatPatternsMatcher().candidates(stringMsg)) {
+          const match = stringMsg.match(pattern)
+          if (match) {
+            matchAny = true
+            bot.emit(type, ...match.slice(1), msg.translate, msg)
+          }
         }
       }
 
@@ -117,3 +127,109 @@ function inject (bot, options) {
 
   bot.tabComplete = tabComplete
 }
+
+/**
+ * Groups chat patterns by the literal text they require at the start of the
+ * message, so a message is only matched against the patterns that can match it.
+ * @param  {Object[]} chatPatterns list of { pattern, type, description }
+ * @return {Object} { candidates(message), compiledFrom(chatPatterns) }
+ */
+function compileChatPatterns (chatPatterns) {
+  const patterns = chatPatterns.slice()
+  // what the entries were compiled from, they may be changed in place afterwards
+  const compiled = patterns.map(({ pattern, type }) => ({ pattern, type }))
+  // first character of the prefix -> list of pattern indexes
+  const byFirstChar = new Map()
+  // indexes of the patterns without a literal prefix, always tried
+  const unprefixed = []
+  const prefixes = patterns.map(({ pattern }) => literalPrefix(pattern))
+  prefixes.forEach((prefix, i) => {
+    if (prefix === '') {
+      unprefixed.push(i)
+      return
+    }
+    if (!byFirstChar.has(prefix[0])) byFirstChar.set(prefix[0], [])
+    byFirstChar.get(prefix[0]).push(i)
+  })
+
+  function candidates (message) {
+    const prefixed = (message.length > 0 && byFirstChar.get(message[0])) || []
+    const result = []
+    // merge both lists of indexes so the patterns are still tried in order
+    let i = 0
+    let j = 0
+    while (i < prefixed.length || j < unprefixed.length) {
+      if (j >= unprefixed.length || (i < prefixed.length && prefixed[i] < unprefixed[j])) {
+        const index = prefixed[i++]
+        if (message.startsWith(prefixes[index])) result.push(patterns[index])
+      } else {
+        result.push(patterns[unprefixed[j++]])
+      }
+    }
+    return result
+  }
+
+  function compiledFrom (list) {
+    if (list.length !== patterns.length) return false
+    for (let i = 0; i < list.length; ++i) {
+      if (list[i] !== patterns[i] || list[i].pattern !== compiled[i].pattern || list[i].type !== compiled[i].type) return false
+    }
+    return true
+  }
+
+  return { candidates, compiledFrom }
+}
+
+const REGEX_SPECIAL_CHARS = '\\^$.|?*+()[]{}'
+
+/**
+ * Returns the text a message must start with to match the regex, '' if it can't tell
+ * @param  {RegExp} pattern
+ * @return {String}
+ */
+function literalPrefix (pattern) {
+  if (!(pattern instanceof RegExp) || pattern.ignoreCase || pattern.multiline) return ''
+  const source = pattern.source
+  if (source[0] !== '^' || hasTopLevelAlternation(source)) return ''
+  let prefix = ''
+  let i = 1
+  while (i < source.length) {
+    let char = source[i]
+    let next = i + 1
+    if (char === '\\') {
+      // only escaped punctuation is literal, \w, \d, \1... are not
+      char = source[i + 1]
+      if (char === undefined || /[0-9A-Za-z]/.test(char)) break
+      next = i + 2
+    } else if (REGEX_SPECIAL_CHARS.includes(char)) {
+      break
+    }
+    // a quantified character may not be there
+    if ('?*{'.includes(source[next])) break
+    prefix += char
+    i = next
+  }
+  return prefix
+}
+
+function hasTopLevelAlternation (source) {
+  let depth = 0
+  let inClass = false
+  for (let i = 0; i < source.length; ++i) {
+    const char = source[i]
+    if (char === '\\') {
+      ++i
+    } else if (inClass) {
+      if (char === ']') inClass = false
+    } else if (char === '[') {
+      inClass = true
+    } else if (char === '(') {
+      ++depth
+    } else if (char === ')') {
+      --depth
+    } else if (char === '|' && depth === 0) {
+      return true
+    }
+  }
+  return false
+}
@@ -33,7 +33,8 @@ function inject (bot, { version }) {
         sourceStart: chest.window.inventorySlotStart,
         sourceEnd: chest.window.inventorySlotStart + windows.INVENTORY_SLOT_COUNT,
         destStart: 0,
-        destEnd: chest.window.inventorySlotStart
+        destEnd: chest.window.inventorySlotStart,
+        shiftClick: true
       }
       bot.transfer(options, cb)
     }
@@ -47,7 +48,8 @@ function inject (bot, { version }) {
         sourceStart: 0,
         sourceEnd: chest.window.inventorySlotStart,
         destStart: chest.window.inventorySlotStart,
-        destEnd: chest.window.inventorySlotStart + windows.INVENTORY_SLOT_COUNT
+        destEnd: chest.window.inventorySlotStart + windows.INVENTORY_SLOT_COUNT,
+        shiftClick: true
       }
       bot.transfer(options, cb)
     }
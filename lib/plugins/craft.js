@@ -2,10 +2,29 @@ const assert = require('assert')
 
 module.exports = inject
 
+// version -> Map(`${itemType}:${metadata}` -> result of Recipe.find)
+const recipeCaches = {}
+
+// how deep planCraft looks for the ingredients of ingredients
+const MAX_PLAN_DEPTH = 8
+
 function inject (bot, { version }) {
   const Item = require('prismarine-item')(version)
   const Recipe = require('prismarine-recipe')(version).Recipe
   const windows = require('prismarine-windows')(version).windows
+  if (!recipeCaches[version]) recipeCaches[version] = new Map()
+  const recipeCache = recipeCaches[version]
+
+  // recipes don't change, so each lookup is only done once per version
+  function findRecipes (itemType, metadata) {
+    const key = `${itemType}:${metadata}`
+    let recipes = recipeCache.get(key)
+    if (recipes === undefined) {
+      recipes = Recipe.find(itemType, metadata)
+      recipeCache.set(key, recipes)
+    }
+    return recipes
+  }
 
   function craft (recipe, count, craftingTable, cb) {
     assert.ok(recipe)
@@ -15,20 +34,11 @@ function inject (bot, { version }) {
       cb(new Error('recipe requires craftingTable'))
       return
     }
-    next()
-    function next (err) {
-      if (err) {
-        cb(err)
-      } else if (count > 0) {
-        count -= 1
-        craftOnce(recipe, craftingTable, next)
-      } else {
-        cb()
-      }
-    }
+    craftSteps([{ recipe, count }], craftingTable, cb)
   }
 
-  function craftOnce (recipe, craftingTable, cb) {
+  // crafts each { recipe, count } step in order, opening the crafting table (if any) only once
+  function craftSteps (steps, craftingTable, cb) {
     if (craftingTable) {
       bot.activateBlock(craftingTable)
       bot.once('windowOpen', (window) => {
@@ -36,13 +46,44 @@ function inject (bot, { version }) {
           cb(new Error('crafting: non craftingTable used as craftingTable'))
           return
         }
-        startClicking(window, 3, 3)
+        craftInWindow(window, 3, 3)
       })
     } else {
-      startClicking(bot.inventory, 2, 2)
+      craftInWindow(bot.inventory, 2, 2)
     }
 
-    function startClicking (window, w, h) {
+    function craftInWindow (window, w, h) {
+      let stepIndex = 0
+      let remaining = steps.length > 0 ? steps[0].count : 0
+      next()
+      function next (err) {
+        if (err) return cb(err)
+        while (stepIndex < steps.length && remaining <= 0) {
+          if (++stepIndex < steps.length) remaining = steps[stepIndex].count
+        }
+        if (stepIndex >= steps.length) {
+          closeTheWindow()
+          return
+        }
+        remaining -= 1
+        craftOnce(steps[stepIndex].recipe, window, w, h, next)
+      }
+
+      function closeTheWindow () {
+        // with pipelined clicks some may not be confirmed yet
+        bot.waitForTransactions((err) => {
+          if (err) return cb(err)
+          bot.closeWindow(window)
+          cb()
+        })
+      }
+    }
+  }
+
+  function craftOnce (recipe, window, w, h, cb) {
+    startClicking()
+
+    function startClicking () {
       const extraSlots = unusedRecipeSlots()
       let ingredientIndex = 0
       let originalSourceSlot = null
@@ -167,7 +208,7 @@ function inject (bot, { version }) {
           for (let i = 1; i <= w * h; i++) {
             window.updateSlot(i, null)
           }
-          closeTheWindow()
+          cb()
           return
         }
         const slotsToClick = []
@@ -193,7 +234,7 @@ function inject (bot, { version }) {
         function next () {
           const theSlot = slotsToClick.pop()
           if (!theSlot) {
-            closeTheWindow()
+            cb()
             return
           }
           bot.putAway(theSlot, (err) => {
@@ -206,11 +247,6 @@ function inject (bot, { version }) {
         }
       }
 
-      function closeTheWindow () {
-        bot.closeWindow(window)
-        cb()
-      }
-
       function slot (x, y) {
         return 1 + x + w * y
       }
@@ -250,7 +286,7 @@ function inject (bot, { version }) {
   function recipesFor (itemType, metadata, minResultCount, craftingTable) {
     minResultCount = minResultCount == null ? 1 : minResultCount
     const results = []
-    Recipe.find(itemType, metadata).forEach((recipe) => {
+    findRecipes(itemType, metadata).forEach((recipe) => {
       if (requirementsMetForRecipe(recipe, minResultCount, craftingTable)) {
         results.push(recipe)
       }
@@ -260,7 +296,7 @@ function inject (bot, { version }) {
 
   function recipesAll (itemType, metadata, craftingTable) {
     const results = []
-    Recipe.find(itemType, metadata).forEach((recipe) => {
+    findRecipes(itemType, metadata).forEach((recipe) => {
       if (!recipe.requiresTable || craftingTable) {
         results.push(recipe)
       }
@@ -284,7 +320,116 @@ function inject (bot, { version }) {
     return true
   }
 
+  /**
+   * Finds the crafts needed to get count itemType from the current inventory,
+   * crafting the missing ingredients too (logs -> planks -> sticks -> tools)
+   * @param  {Number} itemType
+   * @param  {Number} count how many items are wanted, counting the ones already in the inventory
+   * @param  {Object} [options] { metadata, craftingTable }: without craftingTable only the 2x2 recipes are used
+   * @return {Object|null} { steps: [{ recipe, count }], requiresTable }, steps in the order to craft them,
+   * null if it can't be done with the inventory
+   */
+  function planCraft (itemType, count = 1, { metadata = null, craftingTable = null } = {}) {
+    // item type -> Map(metadata -> count) of what the inventory will have
+    const available = new Map()
+    for (const item of bot.inventory.items()) addAvailable(item.type, item.metadata, item.count)
+    const steps = []
+    if (!obtain(itemType, metadata, count, 0, new Set())) return null
+
+    // consecutive crafts of the same recipe are done as one step
+    const merged = []
+    for (const step of steps) {
+      const last = merged[merged.length - 1]
+      if (last && last.recipe === step.recipe) last.count += step.count
+      else merged.push(step)
+    }
+    return { steps: merged, requiresTable: merged.some(step => step.recipe.requiresTable) }
+
+    function addAvailable (type, itemMetadata, itemCount) {
+      if (!available.has(type)) available.set(type, new Map())
+      const byMetadata = available.get(type)
+      byMetadata.set(itemMetadata, (byMetadata.get(itemMetadata) || 0) + itemCount)
+    }
+
+    function countAvailable (type, itemMetadata) {
+      const byMetadata = available.get(type)
+      if (!byMetadata) return 0
+      if (itemMetadata != null) return byMetadata.get(itemMetadata) || 0
+      let sum = 0
+      for (const itemCount of byMetadata.values()) sum += itemCount
+      return sum
+    }
+
+    // takes up to itemCount items out of available, any metadata if itemMetadata is null
+    function consume (type, itemMetadata, itemCount) {
+      const byMetadata = available.get(type)
+      if (!byMetadata) return
+      for (const [key, value] of byMetadata) {
+        if (itemCount === 0) break
+        if (itemMetadata != null && key !== itemMetadata) continue
+        const taken = Math.min(value, itemCount)
+        byMetadata.set(key, value - taken)
+        itemCount -= taken
+      }
+    }
+
+    function snapshot () {
+      return { available: new Map(Array.from(available, ([type, byMetadata]) => [type, new Map(byMetadata)])), steps: steps.length }
+    }
+
+    function restore (saved) {
+      available.clear()
+      for (const [type, byMetadata] of saved.available) available.set(type, byMetadata)
+      steps.length = saved.steps
+    }
+
+    // makes itemCount items of type available (and consumes them), crafting what's missing
+    function obtain (type, itemMetadata, itemCount, depth, path) {
+      const have = Math.min(countAvailable(type, itemMetadata), itemCount)
+      consume(type, itemMetadata, have)
+      const missing = itemCount - have
+      if (missing === 0) return true
+      const key = `${type}:${itemMetadata}`
+      // recipes going back to an item being crafted (ingots <-> blocks) can't help
+      if (depth >= MAX_PLAN_DEPTH || path.has(key)) return false
+      path.add(key)
+      for (const recipe of findRecipes(type, itemMetadata)) {
+        if (recipe.requiresTable && !craftingTable) continue
+        const saved = snapshot()
+        const times = Math.ceil(missing / recipe.result.count)
+        const ingredients = recipe.delta.filter(d => d.count < 0)
+        if (ingredients.every(d => obtain(d.id, d.metadata, -d.count * times, depth + 1, path))) {
+          const products = recipe.delta.filter(d => d.count > 0)
+          if (!products.some(d => d.id === recipe.result.id)) products.push(recipe.result)
+          for (const d of products) addAvailable(d.id, d.metadata, d.count * times)
+          consume(type, itemMetadata, missing)
+          steps.push({ recipe, count: times })
+          path.delete(key)
+          return true
+        }
+        restore(saved)
+      }
+      path.delete(key)
+      return false
+    }
+  }
+
+  /**
+   * Crafts the steps of a plan made by planCraft, in one crafting table window
+   * (or the inventory if the plan doesn't need a table)
+   */
+  function craftPlan (plan, craftingTable, cb) {
+    cb = cb || noop
+    if (plan.requiresTable && !craftingTable) {
+      cb(new Error('plan requires craftingTable'))
+      return
+    }
+    craftSteps(plan.steps, plan.requiresTable ? craftingTable : null, cb)
+  }
+
   bot.craft = craft
+  bot.craftPlan = craftPlan
+  bot.planCraft = planCraft
   bot.recipesFor = recipesFor
   bot.recipesAll = recipesAll
 }
@@ -1,8 +1,13 @@
 module.exports = inject
 
+// ms to wait after a dig for the server to send the damage of the held tool
+const TOOL_UPDATE_TIMEOUT = 500
+
 function inject (bot) {
   let swingInterval = null
   let waitTimeout = null
+  // a block broke with the held item and the server didn't send it back yet
+  let heldItemUpdatePending = false
 
   bot.targetDigBlock = null
   bot.lastDigTime = null
@@ -59,6 +64,7 @@ function inject (bot) {
         waitTimeout = null
         bot.targetDigBlock = null
         bot.lastDigTime = new Date()
+        heldItemUpdatePending = bot.heldItem !== null
         bot.emit('diggingCompleted', newBlock)
         cb()
       }
@@ -85,12 +91,101 @@ function inject (bot) {
   }
 
   function digTime (block) {
+    return digTimeWith(block, bot.heldItem)
+  }
+
+  // how long digging block would take holding item (null for the bare hand)
+  function digTimeWith (block, item) {
     const blockAtPosition = bot.blockAt(bot.entity.position)
-    return block.digTime(bot.heldItem ? bot.heldItem.type : null, bot.game.gameMode === 'creative',
+    return block.digTime(item ? item.type : null, bot.game.gameMode === 'creative',
       blockAtPosition !== null && blockAtPosition.type === 9, !bot.entity.onGround) // only stationary water counts
   }
 
+  // the inventory item digging block the fastest, the held item unless something is strictly faster
+  function bestTool (block) {
+    let best = bot.heldItem
+    let bestTime = digTimeWith(block, best)
+    // quick bar items first, they are equipped without clicking
+    const items = bot.inventory.items().sort((a, b) => (b.slot >= bot.QUICK_BAR_START) - (a.slot >= bot.QUICK_BAR_START))
+    for (const item of items) {
+      const time = digTimeWith(block, item)
+      if (time < bestTime) {
+        best = item
+        bestTime = time
+      }
+    }
+    return best
+  }
+
+  function equipForDigging (item, cb) {
+    if (!item || item === bot.heldItem) return process.nextTick(cb)
+    if (item.slot >= bot.QUICK_BAR_START) {
+      bot.setQuickBarSlot(item.slot - bot.QUICK_BAR_START)
+      return process.nextTick(cb)
+    }
+    // only swap with a hotbar key when clicking the inventory window is possible
+    if (bot.currentWindow || bot.quickBarSlot === null) return process.nextTick(cb)
+    // swap it with the held item with a hotbar key click on its own slot, once the
+    // click can't cross the set_slot of the damage of the held tool
+    waitHeldItemUpdate(() => bot.clickWindow(item.slot, bot.quickBarSlot, 2, cb))
+  }
+
+  // calls cb once the server sent the held item after the last dig, or when it's too late for it to
+  function waitHeldItemUpdate (cb) {
+    const elapsed = bot.lastDigTime === null ? Infinity : new Date() - bot.lastDigTime
+    if (!heldItemUpdatePending || elapsed >= TOOL_UPDATE_TIMEOUT) return process.nextTick(cb)
+    const timeout = setTimeout(done, TOOL_UPDATE_TIMEOUT - elapsed)
+    bot._client.on('set_slot', onSetSlot)
+
+    function onSetSlot () {
+      if (!heldItemUpdatePending) done()
+    }
+
+    function done () {
+      clearTimeout(timeout)
+      bot._client.removeListener('set_slot', onSetSlot)
+      // after the inventory plugin applied the packet
+      process.nextTick(cb)
+    }
+  }
+
+  /**
+   * Digs the blocks one after the other, equipping the best tool of the
+   * inventory for each and starting on the next one as soon as a block is broken.
+   * Blocks that are already air are skipped.
+   * @param {Block[]} blocks blocks (or positions) to dig, in order
+   * @param {Function} cb called when all are dug, or with the first error
+   */
+  function digQueue (blocks, cb) {
+    cb = cb || noop
+    let index = 0
+    next()
+
+    function next (err) {
+      if (err) return cb(err)
+      let block = null
+      while (index < blocks.length && block === null) {
+        const target = blocks[index++]
+        const position = target.position || target
+        block = bot.blockAt(position)
+        if (block === null) return cb(new Error(`digQueue: the block at ${position} isn't loaded`))
+        if (block.type === 0) block = null
+      }
+      if (block === null) return cb()
+      if (!canDigBlock(block)) return cb(new Error(`digQueue: can't dig the block at ${block.position}`))
+      equipForDigging(bestTool(block), (err) => {
+        if (err) return cb(err)
+        dig(block, next)
+      })
+    }
+  }
+
+  bot._client.on('set_slot', (packet) => {
+    if (packet.windowId === 0 && packet.slot === bot.QUICK_BAR_START + bot.quickBarSlot) heldItemUpdatePending = false
+  })
+
   bot.dig = dig
+  bot.digQueue = digQueue
   bot.stopDigging = noop
   bot.canDigBlock = canDigBlock
   bot.digTime = digTime
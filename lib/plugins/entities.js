@@ -1,6 +1,8 @@
 const Vec3 = require('vec3').Vec3
 const Entity = require('prismarine-entity')
 const conv = require('../conversions')
+const { columnKey, columnKeyChunkX, columnKeyChunkZ } = require('../chunk_sections')
+const scheduler = require('../scheduler')
 const NAMED_ENTITY_HEIGHT = 1.62
 const CROUCH_HEIGHT = NAMED_ENTITY_HEIGHT - 0.08
 
@@ -24,7 +26,7 @@ const entityStatusEvents = {
   10: 'entityEatingGrass'
 }
 
-function inject (bot, { version }) {
+function inject (bot, { version, entityIndex, batchEntityEvents, entityFilter }) {
   const objects = require('minecraft-data')(version).objects
   const mobs = require('minecraft-data')(version).mobs
   const entitiesArray = require('minecraft-data')(version).entitiesArray
@@ -65,6 +67,182 @@ function inject (bot, { version }) {
   bot.uuidToUsername = {}
   bot.entities = {}
 
+  // ids of the entities options.entityFilter left out: no Entity is created
+  // for them and the packets about them are skipped
+  const ignoredEntities = new Set()
+  const isTrackedEntity = createEntityFilter(entityFilter)
+
+  // type is the entity.type the entity would get, name its minecraft-data name (or username for players)
+  function tracks (id, type, name) {
+    if (isTrackedEntity === null || isTrackedEntity(type, name)) {
+      ignoredEntities.delete(id)
+      return true
+    }
+    ignoredEntities.add(id)
+    if (bot.entities[id]) {
+      unindexEntity(bot.entities[id])
+      delete bot.entities[id]
+    }
+    return false
+  }
+
+  // with options.entityIndex, entities are bucketed by the chunk column they are in
+  // so the spatial queries only look at the columns around the point
+  // column key -> Set of entities
+  const entityBuckets = entityIndex ? new Map() : null
+  // entity id -> key of the bucket the entity is in
+  const entityBucketKeys = new Map()
+
+  function indexEntity (entity) {
+    if (entityBuckets === null || entity === bot.entity) return
+    const key = columnKey(Math.floor(entity.position.x / 16), Math.floor(entity.position.z / 16))
+    const previousKey = entityBucketKeys.get(entity.id)
+    if (previousKey === key) return
+    if (previousKey !== undefined) removeFromBucket(entity, previousKey)
+    let bucket = entityBuckets.get(key)
+    if (!bucket) {
+      bucket = new Set()
+      entityBuckets.set(key, bucket)
+    }
+    bucket.add(entity)
+    entityBucketKeys.set(entity.id, key)
+  }
+
+  function unindexEntity (entity) {
+    if (entityBuckets === null) return
+    const key = entityBucketKeys.get(entity.id)
+    if (key === undefined) return
+    removeFromBucket(entity, key)
+    entityBucketKeys.delete(entity.id)
+  }
+
+  function removeFromBucket (entity, key) {
+    const bucket = entityBuckets.get(key)
+    bucket.delete(entity)
+    if (bucket.size === 0) entityBuckets.delete(key)
+  }
+
+  // calls callback with the entities that may be in the columns at chebyshev distance ring of the column (chunkX, chunkZ)
+  function forEachEntityInRing (chunkX, chunkZ, ring, callback) {
+    for (let dx = -ring; dx <= ring; ++dx) {
+      const edge = dx === -ring || dx === ring
+      for (let dz = -ring; dz <= ring; dz += edge ? 1 : 2 * ring) {
+        const bucket = entityBuckets.get(columnKey(chunkX + dx, chunkZ + dz))
+        if (bucket) bucket.forEach(callback)
+      }
+    }
+  }
+
+  /**
+   * Returns the entity closest to the bot for which filter returns true, or null
+   * @param  {Function} [filter]
+   * @return {Entity|null}
+   */
+  function nearestEntity (filter = () => true) {
+    const point = bot.entity.position
+    let best = null
+    let bestDistanceSquared = Infinity
+    const consider = (entity) => {
+      if (entity === bot.entity) return
+      const distanceSquared = distanceSquaredBetween(point, entity.position)
+      if (distanceSquared >= bestDistanceSquared || !filter(entity)) return
+      best = entity
+      bestDistanceSquared = distanceSquared
+    }
+
+    if (entityBuckets === null) {
+      for (const id in bot.entities) consider(bot.entities[id])
+      return best
+    }
+
+    const chunkX = Math.floor(point.x / 16)
+    const chunkZ = Math.floor(point.z / 16)
+    let maxRing = 0
+    for (const key of entityBuckets.keys()) {
+      maxRing = Math.max(maxRing, Math.abs(columnKeyChunkX(key) - chunkX), Math.abs(columnKeyChunkZ(key) - chunkZ))
+    }
+    for (let ring = 0; ring <= maxRing; ++ring) {
+      // the entities of that ring are at least that far horizontally
+      const ringDistance = (ring - 1) * 16
+      if (ring > 1 && ringDistance * ringDistance > bestDistanceSquared) break
+      forEachEntityInRing(chunkX, chunkZ, ring, consider)
+    }
+    return best
+  }
+
+  /**
+   * Returns the entities (other than the bot) within radius of the bot for which
+   * filter returns true, closest first
+   * @param  {Number} radius
+   * @param  {Function} [filter]
+   * @return {Entity[]}
+   */
+  function entitiesWithin (radius, filter = () => true) {
+    const point = bot.entity.position
+    const radiusSquared = radius * radius
+    const found = []
+    const consider = (entity) => {
+      if (entity === bot.entity) return
+      const distanceSquared = distanceSquaredBetween(point, entity.position)
+      if (distanceSquared > radiusSquared || !filter(entity)) return
+      found.push({ entity, distanceSquared })
+    }
+
+    if (entityBuckets === null) {
+      for (const id in bot.entities) consider(bot.entities[id])
+    } else {
+      const minChunkX = Math.floor((point.x - radius) / 16)
+      const maxChunkX = Math.floor((point.x + radius) / 16)
+      const minChunkZ = Math.floor((point.z - radius) / 16)
+      const maxChunkZ = Math.floor((point.z + radius) / 16)
+      for (let chunkX = minChunkX; chunkX <= maxChunkX; ++chunkX) {
+        for (let chunkZ = minChunkZ; chunkZ <= maxChunkZ; ++chunkZ) {
+          const bucket = entityBuckets.get(columnKey(chunkX, chunkZ))
+          if (bucket) bucket.forEach(consider)
+        }
+      }
+    }
+
+    found.sort((a, b) => a.distanceSquared - b.distanceSquared)
+    return found.map(({ entity }) => entity)
+  }
+
+  bot.nearestEntity = nearestEntity
+  bot.entitiesWithin = entitiesWithin
+
+  // with options.batchEntityEvents, the entities moved or updated by the packets are
+  // collected and reported once per tick by "entitiesMoved" and "entitiesUpdated"
+  const movedEntities = new Set()
+  const updatedEntities = new Set()
+
+  function entityMoved (entity) {
+    if (batchEntityEvents) movedEntities.add(entity)
+    else bot.emit('entityMoved', entity)
+  }
+
+  function entityUpdated (entity) {
+    if (batchEntityEvents) updatedEntities.add(entity)
+    else bot.emit('entityUpdate', entity)
+  }
+
+  function flushEntityEvents () {
+    if (movedEntities.size > 0) {
+      const entities = Array.from(movedEntities)
+      movedEntities.clear()
+      bot.emit('entitiesMoved', entities)
+    }
+    if (updatedEntities.size > 0) {
+      const entities = Array.from(updatedEntities)
+      updatedEntities.clear()
+      bot.emit('entitiesUpdated', entities)
+    }
+  }
+
+  if (batchEntityEvents) {
+    scheduler.addTask(flushEntityEvents)
+    bot.on('end', () => scheduler.removeTask(flushEntityEvents))
+  }
+
   bot._client.once('login', (packet) => {
     // login
     bot.entity = fetchEntity(packet.entityId)
@@ -72,8 +250,14 @@ function inject (bot, { version }) {
     bot.entity.type = 'player'
   })
 
+  bot._client.on('respawn', () => {
+    // the ids of the entities left out may be given to other entities in the new world
+    ignoredEntities.clear()
+  })
+
   bot._client.on('entity_equipment', (packet) => {
     // entity equipment
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     entity.setEquipment(packet.slot, packet.item ? Item.fromNotch(packet.item) : null)
     bot.emit('entityEquip', entity)
@@ -81,13 +265,16 @@ function inject (bot, { version }) {
 
   bot._client.on('bed', (packet) => {
     // use bed
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     entity.position.set(packet.location.x, packet.location.y, packet.location.z)
+    indexEntity(entity)
     bot.emit('entitySleep', entity)
   })
 
   bot._client.on('animation', (packet) => {
     // animation
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     const eventName = animationEvents[packet.animation]
     if (eventName) bot.emit(eventName, entity)
@@ -97,6 +284,7 @@ function inject (bot, { version }) {
     // in case player_info packet was not sent before named_entity_spawn : ignore named_entity_spawn (see #213)
     if (packet.playerUUID in bot.uuidToUsername) {
       // spawn named entity
+      if (!tracks(packet.entityId, 'player', bot.uuidToUsername[packet.playerUUID])) return
       const entity = fetchEntity(packet.entityId)
       entity.type = 'player'
       entity.username = bot.uuidToUsername[packet.playerUUID]
@@ -115,6 +303,7 @@ function inject (bot, { version }) {
       if (bot.players[entity.username] !== undefined && !bot.players[entity.username].entity) {
         bot.players[entity.username].entity = entity
       }
+      indexEntity(entity)
       bot.emit('entitySpawn', entity)
     }
   })
@@ -129,20 +318,26 @@ function inject (bot, { version }) {
 
   bot._client.on('collect', (packet) => {
     // collect item
+    if (ignoredEntities.has(packet.collectorEntityId)) return
     const collector = fetchEntity(packet.collectorEntityId)
-    const collected = fetchEntity(packet.collectedEntityId)
+    // don't start tracking an ignored item just because it was picked up
+    const collected = ignoredEntities.has(packet.collectedEntityId)
+      ? new Entity(packet.collectedEntityId)
+      : fetchEntity(packet.collectedEntityId)
     bot.emit('playerCollect', collector, collected)
   })
 
   bot._client.on('spawn_entity', (packet) => {
     // spawn object/vehicle
-    const entity = fetchEntity(packet.entityId)
     let entityData = objects[packet.type]
 
     if (entityData === undefined) {
       entityData = entitiesArray.find(entity => entity.internalId === packet.type)
     }
 
+    if (!tracks(packet.entityId, 'object', entityData && entityData.name)) return
+    const entity = fetchEntity(packet.entityId)
+
     if (entityData) {
       entity.type = 'object'
       entity.objectType = entityData.displayName
@@ -168,10 +363,12 @@ function inject (bot, { version }) {
     entity.yaw = conv.fromNotchianYawByte(packet.yaw)
     entity.pitch = conv.fromNotchianPitchByte(packet.pitch)
     entity.objectData = packet.objectData
+    indexEntity(entity)
     bot.emit('entitySpawn', entity)
   })
 
   bot._client.on('spawn_entity_experience_orb', (packet) => {
+    if (!tracks(packet.entityId, 'orb')) return
     const entity = fetchEntity(packet.entityId)
     entity.type = 'orb'
 
@@ -184,20 +381,23 @@ function inject (bot, { version }) {
     }
 
     entity.count = packet.count
+    indexEntity(entity)
     bot.emit('entitySpawn', entity)
   })
 
   bot._client.on('spawn_entity_living', (packet) => {
     // spawn mob
-    const entity = fetchEntity(packet.entityId)
-    entity.type = 'mob'
-    entity.uuid = packet.entityUUID
     let entityData = mobs[packet.type]
 
     if (entityData === undefined) {
       entityData = entitiesArray.find(entity => entity.internalId === packet.type)
     }
 
+    if (!tracks(packet.entityId, 'mob', entityData && entityData.name)) return
+    const entity = fetchEntity(packet.entityId)
+    entity.type = 'mob'
+    entity.uuid = packet.entityUUID
+
     if (entityData === undefined) {
       entity.mobType = 'unknown'
       entity.displayName = 'unknown'
@@ -228,11 +428,13 @@ function inject (bot, { version }) {
     entity.velocity.update(conv.fromNotchVelocity(notchVel))
     entity.metadata = parseMetadata(packet.metadata, entity.metadata)
 
+    indexEntity(entity)
     bot.emit('entitySpawn', entity)
   })
 
   bot._client.on('entity_velocity', (packet) => {
     // entity velocity
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     const notchVel = new Vec3(packet.velocityX, packet.velocityY, packet.velocityZ)
     entity.velocity.update(conv.fromNotchVelocity(notchVel))
@@ -246,9 +448,13 @@ function inject (bot, { version }) {
   bot._client.on('entity_destroy', (packet) => {
     // destroy entity
     packet.entityIds.forEach((id) => {
+      if (ignoredEntities.delete(id)) return
       const entity = fetchEntity(id)
       bot.emit('entityGone', entity)
       entity.isValid = false
+      unindexEntity(entity)
+      movedEntities.delete(entity)
+      updatedEntities.delete(entity)
       if (entity.username && bot.players[entity.username]) {
         bot.players[entity.username].entity = null
       }
@@ -258,6 +464,7 @@ function inject (bot, { version }) {
 
   bot._client.on('rel_entity_move', (packet) => {
     // entity relative move
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     if (bot.majorVersion === '1.8') {
       entity.position.translate(packet.dX / 32, packet.dY / 32, packet.dZ / 32)
@@ -265,19 +472,22 @@ function inject (bot, { version }) {
     if (bot.majorVersion === '1.9' || bot.majorVersion === '1.10' || bot.majorVersion === '1.11' || bot.majorVersion === '1.12' || bot.majorVersion === '1.13') {
       entity.position.translate(packet.dX / (128 * 32), packet.dY / (128 * 32), packet.dZ / (128 * 32))
     }
-    bot.emit('entityMoved', entity)
+    indexEntity(entity)
+    entityMoved(entity)
   })
 
   bot._client.on('entity_look', (packet) => {
     // entity look
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     entity.yaw = conv.fromNotchianYawByte(packet.yaw)
     entity.pitch = conv.fromNotchianPitchByte(packet.pitch)
-    bot.emit('entityMoved', entity)
+    entityMoved(entity)
   })
 
   bot._client.on('entity_move_look', (packet) => {
     // entity look and relative move
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     if (bot.majorVersion === '1.8') {
       entity.position.translate(packet.dX / 32, packet.dY / 32, packet.dZ / 32)
@@ -287,11 +497,13 @@ function inject (bot, { version }) {
     }
     entity.yaw = conv.fromNotchianYawByte(packet.yaw)
     entity.pitch = conv.fromNotchianPitchByte(packet.pitch)
-    bot.emit('entityMoved', entity)
+    indexEntity(entity)
+    entityMoved(entity)
   })
 
   bot._client.on('entity_teleport', (packet) => {
     // entity teleport
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     if (bot.majorVersion === '1.8') {
       entity.position.set(packet.x / 32, packet.y / 32, packet.z / 32)
@@ -301,18 +513,21 @@ function inject (bot, { version }) {
     }
     entity.yaw = conv.fromNotchianYawByte(packet.yaw)
     entity.pitch = conv.fromNotchianPitchByte(packet.pitch)
-    bot.emit('entityMoved', entity)
+    indexEntity(entity)
+    entityMoved(entity)
   })
 
   bot._client.on('entity_head_rotation', (packet) => {
     // entity head look
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     entity.headYaw = conv.fromNotchianYawByte(packet.headYaw)
-    bot.emit('entityMoved', entity)
+    entityMoved(entity)
   })
 
   bot._client.on('entity_status', (packet) => {
     // entity status
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     const eventName = entityStatusEvents[packet.entityStatus]
     if (eventName) bot.emit(eventName, entity)
@@ -320,26 +535,29 @@ function inject (bot, { version }) {
 
   bot._client.on('attach_entity', (packet) => {
     // attach entity
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     if (packet.vehicleId === -1) {
       const vehicle = entity.vehicle
       delete entity.vehicle
       bot.emit('entityDetach', entity, vehicle)
     } else {
-      entity.vehicle = fetchEntity(packet.vehicleId)
+      entity.vehicle = ignoredEntities.has(packet.vehicleId) ? new Entity(packet.vehicleId) : fetchEntity(packet.vehicleId)
       bot.emit('entityAttach', entity, entity.vehicle)
     }
   })
 
   bot._client.on('entity_metadata', (packet) => {
     // entity metadata
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     entity.metadata = parseMetadata(packet.metadata, entity.metadata)
-    bot.emit('entityUpdate', entity)
+    entityUpdated(entity)
   })
 
   bot._client.on('entity_effect', (packet) => {
     // entity effect
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     const effect = {
       id: packet.effectId,
@@ -352,6 +570,7 @@ function inject (bot, { version }) {
 
   bot._client.on('remove_entity_effect', (packet) => {
     // remove entity effect
+    if (ignoredEntities.has(packet.entityId)) return
     const entity = fetchEntity(packet.entityId)
     let effect = entity.effects[packet.effectId]
     if (effect) {
@@ -369,11 +588,13 @@ function inject (bot, { version }) {
 
   bot._client.on('spawn_entity_weather', (packet) => {
     // spawn global entity
+    if (!tracks(packet.entityId, 'global', 'thunderbolt')) return
     const entity = fetchEntity(packet.entityId)
     entity.type = 'global'
     entity.globalType = 'thunderbolt'
     entity.uuid = packet.entityUUID
     entity.position.set(packet.x / 32, packet.y / 32, packet.z / 32)
+    indexEntity(entity)
     bot.emit('entitySpawn', entity)
   })
 
@@ -541,6 +762,21 @@ function inject (bot, { version }) {
   }
 }
 
+// options.entityFilter is either a function (type, name) => boolean or a list of types and names to keep
+function createEntityFilter (filter) {
+  if (!filter) return null
+  if (typeof filter === 'function') return filter
+  const kept = new Set(filter)
+  return (type, name) => kept.has(type) || kept.has(name)
+}
+
+function distanceSquaredBetween (a, b) {
+  const dx = a.x - b.x
+  const dy = a.y - b.y
+  const dz = a.z - b.z
+  return dx * dx + dy * dy + dz * dz
+}
+
 function parseMetadata (metadata, entityMetadata = {}) {
   for (const { key, value } of metadata) {
     entityMetadata[key] = value
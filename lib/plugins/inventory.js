@@ -1,18 +1,33 @@
 const assert = require('assert')
 const Vec3 = require('vec3').Vec3
+const indexWindow = require('../item_index')
 
 module.exports = inject
 
 // ms to wait before clicking on a tool so the server can send the new
 // damage information
 const DIG_CLICK_TIMEOUT = 500
-
-function inject (bot, { version }) {
+// ms to wait for the server to answer a window click before giving up on it
+const CLICK_CONFIRMATION_TIMEOUT = 5000
+// the windows where a shift click moves the stack to the other part of the window
+// like shiftClickChanges does, the others (furnace, brewing stand...) route some items to given slots
+const SHIFT_CLICK_PREDICTED_WINDOWS = ['minecraft:chest', 'minecraft:container', 'minecraft:dispenser', 'minecraft:dropper', 'minecraft:hopper']
+// in the inventory window these go to the armor or off hand slots instead
+const EQUIPMENT_ITEM = /_helmet$|_chestplate$|_leggings$|_boots$|^elytra$|^shield$|^skull$|_head$|_skull$|^pumpkin$|^carved_pumpkin$/
+// shift clicking it fills the whole inventory, hotbar included
+const OFF_HAND_SLOT = 45
+
+function inject (bot, { version, pipelineClicks }) {
   const Item = require('prismarine-item')(version)
   const windows = require('prismarine-windows')(version).windows
 
   let nextActionNumber = 0
   const windowClickQueue = []
+  // with options.pipelineClicks, the set_slot packets received while clicks are
+  // in flight, applied once the server answered all of them
+  const deferredSetSlots = []
+  // first rejection of a pipelined click since the clicks in flight last settled
+  let pipelineError = null
   let lastEating
   let lastFishing
   let lastFloat
@@ -21,7 +36,7 @@ function inject (bot, { version }) {
   // 0-8, null = uninitialized
   // which quick bar slot is selected
   bot.quickBarSlot = null
-  bot.inventory = new windows.InventoryWindow(0, 'Inventory', bot.majorVersion === '1.8' ? 45 : 46)
+  bot.inventory = indexWindow(new windows.InventoryWindow(0, 'Inventory', bot.majorVersion === '1.8' ? 45 : 46), windows.INVENTORY_SLOT_COUNT)
   bot.currentWindow = null
   bot.heldItem = null
 
@@ -111,8 +126,23 @@ function inject (bot, { version }) {
     })
   }
 
+  // with pipelined clicks, the callback of a sequence of clicks is called once the server answered all of them
+  function afterTransactions (cb) {
+    if (!pipelineClicks) return cb
+    return (err) => err ? cb(err) : waitForTransactions(cb)
+  }
+
+  function waitForTransactions (cb) {
+    if (windowClickQueue.length === 0) {
+      cb()
+      return
+    }
+    bot.once('windowClicksSettled', (err) => err ? cb(err) : cb())
+  }
+
   function putSelectedItemRange (start, end, window, slot, cb) {
     // put the selected item back indow the slot range in window
+    cb = afterTransactions(cb)
 
     // try to put it in an item that already exists and just increase
     // the count.
@@ -223,7 +253,7 @@ function inject (bot, { version }) {
     const itemType = options.itemType
     const metadata = options.metadata
     let count = options.count === null ? 1 : options.count
-    cb = cb || noop
+    cb = afterTransactions(cb || noop)
     let firstSourceSlot = null
 
     // ranges
@@ -236,11 +266,37 @@ function inject (bot, { version }) {
 
     transferOne()
 
+    function shiftClickableStack () {
+      for (let slot = sourceStart; slot < sourceEnd; ++slot) {
+        const item = window.slots[slot]
+        if (!item || item.type !== itemType || (metadata != null && item.metadata !== metadata) || item.count > count) continue
+        if (!shiftClickPredictable(window, slot)) continue
+        const changes = shiftClickChanges(window, slot)
+        // the whole stack has to land in the destination range
+        const moved = changes.every(([changed, newItem]) => changed === slot ? newItem === null : changed >= destStart && changed < destEnd)
+        if (moved) return item
+      }
+      return null
+    }
+
     function transferOne () {
       if (count === 0) {
         putSelectedItemRange(sourceStart, sourceEnd, window, firstSourceSlot, cb)
         return
       }
+      // a whole stack that a shift click moves entirely is moved in one click
+      const stack = options.shiftClick && typeof count === 'number' && !window.selectedItem ? shiftClickableStack() : null
+      if (stack) {
+        clickWindow(stack.slot, 0, 1, (err) => {
+          if (err) {
+            cb(err)
+          } else {
+            count -= stack.count
+            transferOne()
+          }
+        })
+        return
+      }
       if (!window.selectedItem || window.selectedItem.type !== itemType ||
         (metadata != null && window.selectedItem.metadata !== metadata)) {
         // we are not holding the item we need. click it.
@@ -442,6 +498,7 @@ function inject (bot, { version }) {
   }
 
   function closeWindow (window) {
+    abandonClicks(new Error('Window closed before the server answered the click.'))
     bot._client.write('close_window', {
       windowId: window.id
     })
@@ -450,9 +507,11 @@ function inject (bot, { version }) {
   }
 
   function confirmTransaction (windowId, actionId, accepted) {
+    // the late answer to a click given up on by abandonClicks
+    if (windowClickQueue.length > 0 && actionId < windowClickQueue[0].id) return
     // drop the queue entries for all the clicks that the server did not send
     // transaction packets for.
-    let click = windowClickQueue.shift()
+    let click = dequeueClick()
     if (click === undefined) {
       console.log(`WARNING : unknown transaction confirmation for window ${windowId}, action ${actionId} and accepted ${accepted}`)
       return
@@ -460,7 +519,7 @@ function inject (bot, { version }) {
     assert.ok(click.id <= actionId)
     while (actionId > click.id) {
       onAccepted()
-      click = windowClickQueue.shift()
+      click = dequeueClick()
     }
     assert.ok(click)
 
@@ -470,11 +529,14 @@ function inject (bot, { version }) {
       onRejected()
     }
     updateHeldItem()
+    if (pipelineClicks) settlePipeline()
 
     function onAccepted () {
       const window = windowId === 0 ? bot.inventory : bot.currentWindow
       if (!window || window.id !== click.windowId) return
-      window.acceptClick(click)
+      // pipelined clicks were applied when sent, and the server sends the slots
+      // changed by the clicks that could not be
+      if (!click.predicted && click.mode === 0) window.acceptClick(click)
       bot.emit(`confirmTransaction${click.id}`, true)
     }
 
@@ -484,10 +546,214 @@ function inject (bot, { version }) {
         action: click.id,
         accepted: false
       })
+      if (click.predicted) {
+        // the clicks sent after that one were predicted from its result, undo them all
+        for (let i = windowClickQueue.length - 1; i >= 0; --i) rollbackClick(windowClickQueue[i])
+        rollbackClick(click)
+        if (pipelineClicks && pipelineError === null) pipelineError = new Error('Server rejected transaction.')
+      }
       bot.emit(`confirmTransaction${click.id}`, false)
     }
   }
 
+  function rollbackClick (click) {
+    if (!click.predicted || click.rolledBack) return
+    click.rolledBack = true
+    const window = click.windowId === 0 ? bot.inventory : bot.currentWindow
+    if (!window || window.id !== click.windowId) return
+    // restore in reverse order in case a slot was changed twice
+    for (let i = click.previous.slots.length - 1; i >= 0; --i) {
+      const [slot, item] = click.previous.slots[i]
+      window.updateSlot(slot, item)
+    }
+    window.selectedItem = click.previous.selectedItem
+  }
+
+  // pipelined clicks the server won't answer are final once it answered the ones before them
+  function settlePipeline () {
+    while (windowClickQueue.length > 0 && !windowClickQueue[0].requiresConfirmation) dequeueClick()
+    if (windowClickQueue.length === 0) clicksSettled()
+  }
+
+  function dequeueClick () {
+    const click = windowClickQueue.shift()
+    if (click !== undefined) clearTimeout(click.timeout)
+    return click
+  }
+
+  /**
+   * Gives up on the clicks in flight when the server won't answer them anymore
+   * (window opened or closed, respawn, disconnection): their predictions are
+   * undone, the slots the server sent meanwhile applied and everything waiting
+   * for them called back with err.
+   */
+  function abandonClicks (err) {
+    const clicks = windowClickQueue.splice(0)
+    if (clicks.length === 0) return
+    for (let i = clicks.length - 1; i >= 0; --i) {
+      clearTimeout(clicks[i].timeout)
+      rollbackClick(clicks[i])
+    }
+    dragging = null
+    for (const click of clicks) bot.emit(`confirmTransaction${click.id}`, false, err)
+    if (pipelineClicks) {
+      if (pipelineError === null) pipelineError = err
+      clicksSettled()
+    }
+    updateHeldItem()
+  }
+
+  // called when the server answered all the pipelined clicks sent
+  function clicksSettled () {
+    const err = pipelineError
+    pipelineError = null
+    for (const packet of deferredSetSlots.splice(0)) setSlot(packet)
+    bot.emit('windowClicksSettled', err)
+  }
+
+  function cloneItem (item, count = item ? item.count : 0) {
+    return item ? new Item(item.type, count, item.metadata, item.nbt) : null
+  }
+
+  function sameItem (a, b) {
+    return a.type === b.type && a.metadata === b.metadata && JSON.stringify(a.nbt) === JSON.stringify(b.nbt)
+  }
+
+  /**
+   * Applies a click to the window the way the server is expected to, and
+   * returns what it changed so it can be rolled back.
+   * @return {Object} { slots: [[slot, previous item]...], selectedItem: previous cursor item }
+   */
+  function predictClick (window, click) {
+    const previous = { slots: [], selectedItem: cloneItem(window.selectedItem) }
+    if (click.mode === 0) {
+      // prismarine-windows knows how left and right clicks behave
+      if (click.slot !== -999) previous.slots.push([click.slot, cloneItem(window.slots[click.slot])])
+      window.acceptClick(click)
+      return previous
+    }
+    let changes = []
+    if (click.mode === 1) {
+      changes = shiftClickChanges(window, click.slot)
+    } else if (click.mode === 2) {
+      const hotbarSlot = window.inventorySlotStart + windows.INVENTORY_SLOT_COUNT - 9 + click.mouseButton
+      if (hotbarSlot !== click.slot) {
+        changes = [[click.slot, window.slots[hotbarSlot]], [hotbarSlot, window.slots[click.slot]]]
+      }
+    } else if (click.mode === 5) {
+      changes = dragChanges(window, click)
+    }
+    for (const [slot] of changes) previous.slots.push([slot, cloneItem(window.slots[slot])])
+    for (const [slot, item] of changes) window.updateSlot(slot, item)
+    return previous
+  }
+
+  // true if shiftClickChanges knows where a shift click on slot moves the stack
+  function shiftClickPredictable (window, slot) {
+    const item = window.slots[slot]
+    if (!item) return true
+    if (window.id !== 0) return SHIFT_CLICK_PREDICTED_WINDOWS.includes(window.type)
+    // shift clicking the crafting result crafts as many as possible
+    return slot !== 0 && slot !== OFF_HAND_SLOT && !EQUIPMENT_ITEM.test(item.name)
+  }
+
+  /**
+   * Returns the [slot, item] changes a shift click on slot does: the stack goes
+   * to the other part of the window (container <-> inventory, or main inventory
+   * <-> hotbar in the inventory window), first joining the stacks of the same
+   * item then in the first empty slot.
+   */
+  function shiftClickChanges (window, slot) {
+    const item = window.slots[slot]
+    if (!item) return []
+    const inventoryStart = window.inventorySlotStart
+    const inventoryEnd = inventoryStart + windows.INVENTORY_SLOT_COUNT
+    const hotbarStart = inventoryEnd - 9
+    let start
+    let end
+    let reverse = false
+    if (slot < inventoryStart) {
+      // the container (or crafting grid and armor) to the inventory, filled from the end like the server does
+      start = inventoryStart
+      end = inventoryEnd
+      reverse = window.id !== 0 || slot === 0
+    } else if (window.id !== 0) {
+      start = 0
+      end = inventoryStart
+    } else if (slot < hotbarStart) {
+      start = hotbarStart
+      end = inventoryEnd
+    } else {
+      start = inventoryStart
+      end = hotbarStart
+    }
+    const slots = []
+    for (let i = start; i < end; ++i) slots.push(i)
+    if (reverse) slots.reverse()
+
+    const stackSize = item.stackSize || 64
+    const changes = []
+    let remaining = item.count
+    for (const i of slots) {
+      const other = window.slots[i]
+      if (!other || !sameItem(other, item) || other.count >= stackSize) continue
+      const moved = Math.min(stackSize - other.count, remaining)
+      changes.push([i, cloneItem(other, other.count + moved)])
+      remaining -= moved
+      if (remaining === 0) break
+    }
+    if (remaining > 0) {
+      const empty = slots.find(i => !window.slots[i])
+      if (empty !== undefined) {
+        changes.push([empty, cloneItem(item, remaining)])
+        remaining = 0
+      }
+    }
+    changes.push([slot, remaining > 0 ? cloneItem(item, remaining) : null])
+    return changes
+  }
+
+  // drag state of the mode 5 clicks: { right, slots } between the start and end clicks
+  let dragging = null
+
+  /**
+   * Returns the [slot, item] changes of a drag click. The cursor item is only
+   * spread on the end click: evenly with the left button, one item per slot with
+   * the right one. window.selectedItem is updated here.
+   */
+  function dragChanges (window, { slot, mouseButton }) {
+    const step = mouseButton & 3
+    if (step === 0) {
+      dragging = { right: mouseButton === 4, slots: [] }
+      return []
+    }
+    if (dragging === null) return []
+    const cursor = window.selectedItem
+    if (step === 1) {
+      const item = window.slots[slot]
+      if (cursor && (!item || sameItem(item, cursor)) && !dragging.slots.includes(slot)) dragging.slots.push(slot)
+      return []
+    }
+    const { right, slots } = dragging
+    dragging = null
+    if (!cursor || slots.length === 0 || (!right && cursor.count < slots.length)) return []
+    const stackSize = cursor.stackSize || 64
+    const perSlot = right ? 1 : Math.floor(cursor.count / slots.length)
+    let remaining = cursor.count
+    const changes = []
+    for (const i of slots) {
+      if (remaining === 0) break
+      const item = window.slots[i]
+      const count = item ? item.count : 0
+      const added = Math.min(perSlot, stackSize - count, remaining)
+      if (added <= 0) continue
+      changes.push([i, cloneItem(cursor, count + added)])
+      remaining -= added
+    }
+    window.selectedItem = remaining > 0 ? cloneItem(cursor, remaining) : null
+    return changes
+  }
+
   function clickWindow (slot, mouseButton, mode, cb) {
     // if you click on the quick bar and have dug recently,
     // wait a bit
@@ -503,8 +769,17 @@ function inject (bot, { version }) {
     cb = cb || noop
     const window = bot.currentWindow || bot.inventory
 
-    assert.ok(mouseButton === 0 || mouseButton === 1)
-    assert.strictEqual(mode, 0)
+    // 0: left/right click, 1: shift click, 2: swap with the hotbar slot mouseButton
+    // 5: drag (mouseButton 0/4 start, 1/5 add slot, 2/6 end, left/right)
+    if (mode === 0 || mode === 1) assert.ok(mouseButton === 0 || mouseButton === 1)
+    else if (mode === 2) assert.ok(mouseButton >= 0 && mouseButton <= 8)
+    else if (mode === 5) assert.ok([0, 1, 2, 4, 5, 6].includes(mouseButton))
+    else assert.ok(false, `unsupported click mode ${mode}`)
+    if (pipelineClicks && pipelineError !== null) {
+      // don't build on a prediction the server already rejected
+      process.nextTick(cb, pipelineError)
+      return
+    }
     const actionId = createActionNumber()
 
     const click = {
@@ -515,7 +790,15 @@ function inject (bot, { version }) {
       windowId: window.id,
       item: slot === -999 ? null : window.slots[slot]
     }
+    // notchian servers are assholes and only confirm certain transactions.
+    const requiresConfirmation = window.transactionRequiresConfirmation(click)
+    click.requiresConfirmation = requiresConfirmation
+    // even the pipelined clicks the server won't answer are queued: they are
+    // rolled back with the one before them if it gets rejected
     windowClickQueue.push(click)
+    if (requiresConfirmation) {
+      click.timeout = setTimeout(() => abandonClicks(new Error('Server did not answer transaction.')), CLICK_CONFIRMATION_TIMEOUT)
+    }
     bot._client.write('window_click', {
       windowId: window.id,
       slot,
@@ -524,21 +807,42 @@ function inject (bot, { version }) {
       mode,
       item: Item.toNotch(click.item)
     })
-    bot.once(`confirmTransaction${actionId}`, (success) => {
+    // prismarine-windows only knows how to apply left and right clicks once
+    // accepted, the other modes are predicted unless it's a shift click we can't tell
+    // the outcome of, then the window is updated by the set_slot packets of the server
+    if ((pipelineClicks || mode !== 0) && (mode !== 1 || shiftClickPredictable(window, slot))) {
+      // apply the click now so the next one can be planned without waiting for
+      // the server, keeping what it changed in case it gets rejected
+      click.predicted = true
+      click.previous = predictClick(window, click)
+      updateHeldItem()
+    }
+    if (pipelineClicks) {
+      if (!requiresConfirmation) settlePipeline()
+      if (click.predicted) {
+        // the callback only means the click was sent, see waitForTransactions for its outcome
+        process.nextTick(cb)
+      } else {
+        // the next clicks are planned on the slots the server sent
+        waitForTransactions(cb)
+      }
+      return
+    }
+    bot.once(`confirmTransaction${actionId}`, (success, err) => {
       if (success) {
         cb()
       } else {
-        cb(new Error('Server rejected transaction.'))
+        cb(err || new Error('Server rejected transaction.'))
       }
     })
-    // notchian servers are assholes and only confirm certain transactions.
-    if (!window.transactionRequiresConfirmation(click)) {
+    if (!requiresConfirmation) {
       // jump the gun and accept the click
       confirmTransaction(window.id, actionId, true)
     }
   }
 
   function putAway (slot, cb) {
+    cb = afterTransactions(cb)
     clickWindow(slot, 0, 0, (err) => {
       if (err) return cb(err)
       const window = bot.currentWindow || bot.inventory
@@ -549,6 +853,7 @@ function inject (bot, { version }) {
   }
 
   function moveSlotItem (sourceSlot, destSlot, cb) {
+    cb = afterTransactions(cb)
     clickWindow(sourceSlot, 0, 0, (err) => {
       if (err) return cb(err)
       clickWindow(destSlot, 0, 0, (err) => {
@@ -580,9 +885,10 @@ function inject (bot, { version }) {
     updateHeldItem()
   })
   bot._client.on('open_window', (packet) => {
+    abandonClicks(new Error('Window opened before the server answered the click.'))
     // open window
-    bot.currentWindow = windows.createWindow(packet.windowId,
-      packet.inventoryType, packet.windowTitle, packet.slotCount)
+    bot.currentWindow = indexWindow(windows.createWindow(packet.windowId,
+      packet.inventoryType, packet.windowTitle, packet.slotCount), windows.INVENTORY_SLOT_COUNT)
     const window = bot.currentWindow
     if (!windowItems || window.id !== windowItems.windowId) {
       // don't emit windowOpen until we have the slot data
@@ -601,12 +907,30 @@ function inject (bot, { version }) {
     }
   })
   bot._client.on('close_window', (packet) => {
+    abandonClicks(new Error('Window closed before the server answered the click.'))
     // close window
     const oldWindow = bot.currentWindow
     bot.currentWindow = null
     bot.emit('windowClose', oldWindow)
   })
   bot._client.on('set_slot', (packet) => {
+    // the predicted state of pipelined clicks would be overwritten by an older one
+    if (pipelineClicks && windowClickQueue.length > 0) {
+      deferredSetSlots.push(packet)
+      return
+    }
+    setSlot(packet)
+  })
+
+  bot._client.on('respawn', () => {
+    abandonClicks(new Error('Respawned before the server answered the click.'))
+  })
+
+  bot.on('end', () => {
+    abandonClicks(new Error('Disconnected before the server answered the click.'))
+  })
+
+  function setSlot (packet) {
     // set slot
     const window = packet.windowId === 0 ? bot.inventory : bot.currentWindow
     if (!window || window.id !== packet.windowId) return
@@ -615,7 +939,7 @@ function inject (bot, { version }) {
     window.updateSlot(packet.slot, newItem)
     updateHeldItem()
     bot.emit(`setSlot:${window.id}`, oldItem, newItem)
-  })
+  }
   bot._client.on('window_items', (packet) => {
     const window = packet.windowId === 0 ? bot.inventory : bot.currentWindow
     if (!window || window.id !== packet.windowId) {
@@ -653,6 +977,7 @@ function inject (bot, { version }) {
   bot.openEntity = openEntity
   bot.moveSlotItem = moveSlotItem
   bot.updateHeldItem = updateHeldItem
+  bot.waitForTransactions = waitForTransactions
 }
 
 function noop (err) {
@@ -1,19 +1,27 @@
-const Vec3 = require('vec3').Vec3
 const assert = require('assert')
 const math = require('../math')
 const conv = require('../conversions')
+const scheduler = require('../scheduler')
+const { movementPacketName } = require('../movement_packets')
 
 module.exports = inject
 
 const EPSILON = 0.000001 // good enough so that the player can actually see the bot landing and so the bot doesn't die from "fell from high ground"
 const PI = Math.PI
 const PI_2 = Math.PI * 2
-const POSITION_UPDATE_INTERVAL_MS = 50
-const PHYSICS_INTERVAL_MS = 50
 const MAX_PHYSICS_DELTA_SECONDS = 0.2
+// with fixedTimestepPhysics, the game advances by whole server ticks
+const PHYSICS_TIMESTEP_MS = scheduler.TICK_MS
+// ticks we didn't have time to simulate beyond this are dropped
+const MAX_CATCH_UP_TICKS = 10
 const WAIT_TIME_BEFORE_NEW_JUMP = 0.07
+// blocks per side of the cube of cached collision flags around the player
+const COLLISION_CACHE_SIZE = 16
+// the position is sent at least once a second, even when it didn't move
+const POSITION_REFRESH_TICKS = 20
 
-function inject (bot) {
+function inject (bot, { version, fixedTimestepPhysics }) {
+  const blockStates = require('../block_states')(version)
   const physics = {
     maxGroundSpeed: 4.317, // according to the internet
     terminalVelocity: 20.0, // guess
@@ -40,19 +48,39 @@ function inject (bot) {
   }
   let jumpQueued = false
   let lastSentYaw = null
-  let positionUpdateTimer = null
-  let doPhysicsTimer = null
+  let positionUpdatesRunning = false
+  let physicsRunning = false
   let lastPositionSentTime = null
   let lastPhysicsFrameTime = null
+  let physicsTimeAccumulator = 0
   let lastFlyingUpdate = 0
+  // what the server was last told, to only send what changed
+  const lastSent = { x: 0, y: 0, z: 0, yaw: 0, pitch: 0, onGround: false, sprint: false, sneak: false }
+  let ticksSincePositionSent = 0
+  // position and look (notchian) of the last "move" event
+  const lastMove = { x: NaN, y: NaN, z: NaN, yaw: NaN, pitch: NaN }
 
   function doPhysics () {
-    const now = new Date()
-    const deltaSeconds = (now - lastPhysicsFrameTime) / 1000
+    const now = Date.now()
+    const deltaMs = now - lastPhysicsFrameTime
     lastPhysicsFrameTime = now
+    if (fixedTimestepPhysics) {
+      // catch up in whole ticks, whatever the timer lag was
+      physicsTimeAccumulator += deltaMs
+      let ticks = Math.floor(physicsTimeAccumulator / PHYSICS_TIMESTEP_MS)
+      physicsTimeAccumulator -= ticks * PHYSICS_TIMESTEP_MS
+      if (ticks > MAX_CATCH_UP_TICKS) ticks = MAX_CATCH_UP_TICKS
+      for (let i = 0; i < ticks; ++i) {
+        nextFrame(PHYSICS_TIMESTEP_MS / 1000)
+        bot.emit('physicsTick')
+      }
+      return
+    }
+    const deltaSeconds = deltaMs / 1000
     const deltaToUse = deltaSeconds < MAX_PHYSICS_DELTA_SECONDS
       ? deltaSeconds : MAX_PHYSICS_DELTA_SECONDS
     nextFrame(deltaToUse)
+    bot.emit('physicsTick')
   }
 
   function cleanup () {
@@ -61,52 +89,113 @@ function inject (bot) {
   }
 
   function stopPositionUpdates () {
-    clearInterval(positionUpdateTimer)
-    positionUpdateTimer = null
+    scheduler.removeTask(sendPosition)
+    positionUpdatesRunning = false
   }
 
   function stopPhysics () {
-    clearInterval(doPhysicsTimer)
-    doPhysicsTimer = null
+    scheduler.removeTask(doPhysics)
+    physicsRunning = false
+  }
+
+  // solid (1), not solid (0) or unknown (-1) flags of the blocks in a cube
+  // around the player, so a physics frame doesn't have to read the world
+  const collisionCache = new Int8Array(COLLISION_CACHE_SIZE * COLLISION_CACHE_SIZE * COLLISION_CACHE_SIZE).fill(-1)
+  let collisionCacheX = 0
+  let collisionCacheY = 0
+  let collisionCacheZ = 0
+
+  function collisionCacheIndex (x, y, z) {
+    x -= collisionCacheX
+    y -= collisionCacheY
+    z -= collisionCacheZ
+    if (x < 0 || y < 0 || z < 0 || x >= COLLISION_CACHE_SIZE || y >= COLLISION_CACHE_SIZE || z >= COLLISION_CACHE_SIZE) return -1
+    return (y * COLLISION_CACHE_SIZE + z) * COLLISION_CACHE_SIZE + x
+  }
+
+  // move the cached cube if the player got close to its border
+  function centerCollisionCache (pos) {
+    const margin = COLLISION_CACHE_SIZE / 4
+    const x = Math.floor(pos.x) - collisionCacheX
+    const y = Math.floor(pos.y) - collisionCacheY
+    const z = Math.floor(pos.z) - collisionCacheZ
+    if (x >= margin && y >= margin && z >= margin &&
+      x < COLLISION_CACHE_SIZE - margin && y < COLLISION_CACHE_SIZE - margin && z < COLLISION_CACHE_SIZE - margin) return
+    collisionCacheX = Math.floor(pos.x) - COLLISION_CACHE_SIZE / 2
+    collisionCacheY = Math.floor(pos.y) - COLLISION_CACHE_SIZE / 2
+    collisionCacheZ = Math.floor(pos.z) - COLLISION_CACHE_SIZE / 2
+    collisionCache.fill(-1)
   }
 
+  function isSolid (x, y, z) {
+    const index = collisionCacheIndex(x, y, z)
+    if (index !== -1 && collisionCache[index] !== -1) return collisionCache[index] === 1
+    const stateId = bot.blockStateAt(x, y, z)
+    const solid = stateId !== null && blockStates.isSolid(stateId)
+    if (index !== -1) collisionCache[index] = solid ? 1 : 0
+    return solid
+  }
+
+  function blockTypeAt (x, y, z) {
+    const stateId = bot.blockStateAt(x, y, z)
+    return stateId === null ? null : blockStates.typeOf(stateId)
+  }
+
+  bot.on('blockUpdateBatch', (changes) => {
+    for (let i = 0; i < changes.length; i += 5) {
+      const index = collisionCacheIndex(changes[i], changes[i + 1], changes[i + 2])
+      if (index !== -1) collisionCache[index] = -1
+    }
+  })
+  bot.on('chunkColumnLoad', () => collisionCache.fill(-1))
+  bot.on('chunkColumnUnload', () => collisionCache.fill(-1))
+
   function nextFrame (deltaSeconds) {
     if (deltaSeconds < EPSILON) return // too fast
-    const pos = bot.entity.position
-    const vel = bot.entity.velocity
+    centerCollisionCache(bot.entity.position)
+    simulateFrame(bot.entity, controlState, jumpQueued, deltaSeconds)
+    jumpQueued = false
+  }
+
+  // advances the player state (position, velocity, yaw, onGround and
+  // timeSinceOnGround) of `entity` by one frame, without sending anything
+  function simulateFrame (entity, controls, jumpQueued, deltaSeconds) {
+    const pos = entity.position
+    const vel = entity.velocity
 
     // derive xy movement vector from controls
     let movementRight = 0
-    if (controlState.right) movementRight += 1
-    if (controlState.left) movementRight -= 1
+    if (controls.right) movementRight += 1
+    if (controls.left) movementRight -= 1
     let movementForward = 0
-    if (controlState.forward) movementForward += 1
-    if (controlState.back) movementForward -= 1
+    if (controls.forward) movementForward += 1
+    if (controls.back) movementForward -= 1
 
     // acceleration is m/s/s
-    const acceleration = new Vec3(0, 0, 0)
+    let accelerationX = 0
+    let accelerationY = 0
+    let accelerationZ = 0
     if (movementForward || movementRight) {
       // input acceleration
       const rotationFromInput = Math.atan2(-movementRight, movementForward)
-      const inputYaw = bot.entity.yaw + rotationFromInput
-      acceleration.x += physics.walkingAcceleration * -Math.sin(inputYaw)
-      acceleration.z += physics.walkingAcceleration * -Math.cos(inputYaw)
-      if (controlState.sprint) {
-        acceleration.x *= physics.sprintSpeed
-        acceleration.z *= physics.sprintSpeed
+      const inputYaw = entity.yaw + rotationFromInput
+      accelerationX += physics.walkingAcceleration * -Math.sin(inputYaw)
+      accelerationZ += physics.walkingAcceleration * -Math.cos(inputYaw)
+      if (controls.sprint) {
+        accelerationX *= physics.sprintSpeed
+        accelerationZ *= physics.sprintSpeed
       }
     }
 
     // jumping
-    if ((controlState.jump || jumpQueued) && bot.entity.onGround && bot.entity.timeSinceOnGround > WAIT_TIME_BEFORE_NEW_JUMP) {
+    if ((controls.jump || jumpQueued) && entity.onGround && entity.timeSinceOnGround > WAIT_TIME_BEFORE_NEW_JUMP) {
       vel.y = physics.jumpSpeed
     }
-    jumpQueued = false
 
     // gravity
-    acceleration.y -= physics.gravity
+    accelerationY -= physics.gravity
 
-    const oldGroundSpeedSquared = calcGroundSpeedSquared()
+    const oldGroundSpeedSquared = vel.x * vel.x + vel.z * vel.z
     if (oldGroundSpeedSquared < EPSILON) {
       // stopped
       vel.x = 0
@@ -116,34 +205,34 @@ function inject (bot) {
       const oldGroundSpeed = Math.sqrt(oldGroundSpeedSquared)
       let groundFriction = physics.groundFriction * physics.walkingAcceleration
       // less friction for air
-      if (!bot.entity.onGround) groundFriction *= 0.05
+      if (!entity.onGround) groundFriction *= 0.05
       // if friction would stop the motion, do it
       const maybeNewGroundFriction = oldGroundSpeed / deltaSeconds
       groundFriction = groundFriction > maybeNewGroundFriction
         ? maybeNewGroundFriction : groundFriction
-      acceleration.x -= vel.x / oldGroundSpeed * groundFriction
-      acceleration.z -= vel.z / oldGroundSpeed * groundFriction
+      accelerationX -= vel.x / oldGroundSpeed * groundFriction
+      accelerationZ -= vel.z / oldGroundSpeed * groundFriction
     }
 
     // calculate new speed
-    vel.add(acceleration.scaled(deltaSeconds))
+    vel.x += accelerationX * deltaSeconds
+    vel.y += accelerationY * deltaSeconds
+    vel.z += accelerationZ * deltaSeconds
 
     // limit speed
     let currentMaxGroundSpeed
-    const underBlock = bot.blockAt(pos.offset(0, -1, 0))
-    const inBlock = bot.blockAt(pos.offset(0, 0, 0))
-    if (underBlock && underBlock.type === 88) {
+    if (blockTypeAt(pos.x, pos.y - 1, pos.z) === 88) {
       currentMaxGroundSpeed = physics.maxGroundSpeedSoulSand
-    } else if (inBlock && inBlock.type === 9) {
+    } else if (blockTypeAt(pos.x, pos.y, pos.z) === 9) {
       currentMaxGroundSpeed = physics.maxGroundSpeedWater
     } else {
       currentMaxGroundSpeed = physics.maxGroundSpeed
     }
-    if (controlState.sprint) {
+    if (controls.sprint) {
       currentMaxGroundSpeed *= physics.sprintSpeed
     }
 
-    const groundSpeedSquared = calcGroundSpeedSquared()
+    const groundSpeedSquared = vel.x * vel.x + vel.z * vel.z
     if (groundSpeedSquared > currentMaxGroundSpeed * currentMaxGroundSpeed) {
       const groundSpeed = Math.sqrt(groundSpeedSquared)
       const correctionScale = currentMaxGroundSpeed / groundSpeed
@@ -153,61 +242,73 @@ function inject (bot) {
     vel.y = math.clamp(-physics.terminalVelocity, vel.y, physics.terminalVelocity)
 
     // calculate new positions and resolve collisions
-    let boundingBox = getBoundingBox()
-    let boundingBoxMin
-    let boundingBoxMax
+    // the bounding box of the player, in blocks
+    let minX = Math.floor(pos.x - physics.playerApothem)
+    let maxX = Math.floor(pos.x + physics.playerApothem)
+    const minY = Math.floor(pos.y)
+    const maxY = Math.floor(pos.y + physics.playerHeight)
+    let minZ = Math.floor(pos.z - physics.playerApothem)
+    let maxZ = Math.floor(pos.z + physics.playerApothem)
     if (vel.x !== 0) {
       pos.x += vel.x * deltaSeconds
       const blockX = Math.floor(pos.x + math.sign(vel.x) * physics.playerApothem)
-      boundingBoxMin = new Vec3(blockX, boundingBox.min.y, boundingBox.min.z)
-      boundingBoxMax = new Vec3(blockX, boundingBox.max.y, boundingBox.max.z)
-      if (collisionInRange(boundingBoxMin, boundingBoxMax)) {
+      if (collisionInRange(blockX, minY, minZ, blockX, maxY, maxZ)) {
         pos.x = blockX + (vel.x < 0 ? 1 + physics.playerApothem : -physics.playerApothem) * 1.001
         vel.x = 0
-        boundingBox = getBoundingBox()
+        minX = Math.floor(pos.x - physics.playerApothem)
+        maxX = Math.floor(pos.x + physics.playerApothem)
       }
     }
 
     if (vel.z !== 0) {
       pos.z += vel.z * deltaSeconds
       const blockZ = Math.floor(pos.z + math.sign(vel.z) * physics.playerApothem)
-      boundingBoxMin = new Vec3(boundingBox.min.x, boundingBox.min.y, blockZ)
-      boundingBoxMax = new Vec3(boundingBox.max.x, boundingBox.max.y, blockZ)
-      if (collisionInRange(boundingBoxMin, boundingBoxMax)) {
+      if (collisionInRange(minX, minY, blockZ, maxX, maxY, blockZ)) {
         pos.z = blockZ + (vel.z < 0 ? 1 + physics.playerApothem : -physics.playerApothem) * 1.001
         vel.z = 0
-        boundingBox = getBoundingBox()
+        minZ = Math.floor(pos.z - physics.playerApothem)
+        maxZ = Math.floor(pos.z + physics.playerApothem)
       }
     }
 
-    bot.entity.onGround = false
+    entity.onGround = false
     if (vel.y !== 0) {
       pos.y += vel.y * deltaSeconds
       const playerHalfHeight = physics.playerHeight / 2
       const blockY = Math.floor(pos.y + playerHalfHeight + math.sign(vel.y) * playerHalfHeight)
-      boundingBoxMin = new Vec3(boundingBox.min.x, blockY, boundingBox.min.z)
-      boundingBoxMax = new Vec3(boundingBox.max.x, blockY, boundingBox.max.z)
-      if (collisionInRange(boundingBoxMin, boundingBoxMax)) {
+      if (collisionInRange(minX, blockY, minZ, maxX, blockY, maxZ)) {
         pos.y = blockY + (vel.y < 0 ? 1 : -physics.playerHeight) * 1.001
-        bot.entity.onGround = vel.y < 0 ? true : bot.entity.onGround
+        entity.onGround = vel.y < 0 ? true : entity.onGround
         vel.y = 0
       }
     }
-    if (bot.entity.onGround) {
-      bot.entity.timeSinceOnGround += deltaSeconds
+    if (entity.onGround) {
+      entity.timeSinceOnGround += deltaSeconds
     } else {
-      bot.entity.timeSinceOnGround = 0
+      entity.timeSinceOnGround = 0
     }
   }
 
-  function collisionInRange (boundingBoxMin, boundingBoxMax) {
-    const cursor = new Vec3(0, 0, 0)
-    let block
-    for (cursor.x = boundingBoxMin.x; cursor.x <= boundingBoxMax.x; cursor.x++) {
-      for (cursor.y = boundingBoxMin.y; cursor.y <= boundingBoxMax.y; cursor.y++) {
-        for (cursor.z = boundingBoxMin.z; cursor.z <= boundingBoxMax.z; cursor.z++) {
-          block = bot.blockAt(cursor)
-          if (block && block.boundingBox === 'block') return true
+  function simulate (state, controls = {}, ticks = 1) {
+    state = state || bot.entity
+    const simulated = {
+      position: state.position.clone(),
+      velocity: state.velocity.clone(),
+      yaw: state.yaw,
+      onGround: state.onGround,
+      timeSinceOnGround: state.timeSinceOnGround || 0
+    }
+    for (let i = 0; i < ticks; ++i) {
+      simulateFrame(simulated, controls, false, PHYSICS_TIMESTEP_MS / 1000)
+    }
+    return simulated
+  }
+
+  function collisionInRange (minX, minY, minZ, maxX, maxY, maxZ) {
+    for (let x = minX; x <= maxX; x++) {
+      for (let y = minY; y <= maxY; y++) {
+        for (let z = minZ; z <= maxZ; z++) {
+          if (isSolid(x, y, z)) return true
         }
       }
     }
@@ -215,27 +316,6 @@ function inject (bot) {
     return false
   }
 
-  function calcGroundSpeedSquared () {
-    const vel = bot.entity.velocity
-    return vel.x * vel.x + vel.z * vel.z
-  }
-
-  function getBoundingBox () {
-    const pos = bot.entity.position
-    return {
-      min: new Vec3(
-        pos.x - physics.playerApothem,
-        pos.y,
-        pos.z - physics.playerApothem
-      ).floor(),
-      max: new Vec3(
-        pos.x + physics.playerApothem,
-        pos.y + physics.playerHeight,
-        pos.z + physics.playerApothem
-      ).floor()
-    }
-  }
-
   function sendPositionAndLook (entity) {
     // sends data, no logic
     const packet = {
@@ -247,10 +327,64 @@ function inject (bot) {
     packet.yaw = conv.toNotchianYaw(entity.yaw)
     packet.pitch = conv.toNotchianPitch(entity.pitch)
     bot._client.write('position_look', packet)
+    Object.assign(lastSent, packet)
+    ticksSincePositionSent = 0
 
+    emitMove(packet.x, packet.y, packet.z, packet.yaw, packet.pitch)
+  }
+
+  // "move" is only emitted when the position or the look changed since the last one
+  function emitMove (x, y, z, yaw, pitch) {
+    if (x === lastMove.x && y === lastMove.y && z === lastMove.z && yaw === lastMove.yaw && pitch === lastMove.pitch) return
+    lastMove.x = x
+    lastMove.y = y
+    lastMove.z = z
+    lastMove.yaw = yaw
+    lastMove.pitch = pitch
     bot.emit('move')
   }
 
+  // sends the packet with only what changed since the last one (position_look, position, look or flying)
+  function sendMovement (entity) {
+    const { x, y, z } = entity.position
+    const yaw = conv.toNotchianYaw(entity.yaw)
+    const pitch = conv.toNotchianPitch(entity.pitch)
+    const onGround = entity.onGround
+    const name = movementPacketName(lastSent, { x, y, z, yaw, pitch, onGround }, ++ticksSincePositionSent >= POSITION_REFRESH_TICKS)
+    if (name === 'position_look') {
+      bot._client.write(name, { x, y, z, yaw, pitch, onGround })
+    } else if (name === 'position') {
+      bot._client.write(name, { x, y, z, onGround })
+    } else if (name === 'look') {
+      bot._client.write(name, { yaw, pitch, onGround })
+    } else if (name === 'flying') {
+      bot._client.write(name, { onGround })
+    }
+    if (name === 'position_look' || name === 'position') {
+      lastSent.x = x
+      lastSent.y = y
+      lastSent.z = z
+      ticksSincePositionSent = 0
+    }
+    if (name === 'position_look' || name === 'look') {
+      lastSent.yaw = yaw
+      lastSent.pitch = pitch
+    }
+    lastSent.onGround = onGround
+
+    emitMove(x, y, z, yaw, pitch)
+  }
+
+  // sends the start or the stop of sprinting or sneaking if the server doesn't know it yet
+  function sendAction (control) {
+    if (controlState[control] === lastSent[control]) return
+    lastSent[control] = controlState[control]
+    const actionId = control === 'sprint'
+      ? (controlState.sprint ? 3 : 4)
+      : (controlState.sneak ? 0 : 1)
+    bot._client.write('entity_action', { entityId: bot.entity.id, actionId, jumpBoost: 0 })
+  }
+
   function sendPosition () {
     // increment the yaw in baby steps so that notchian clients (not the server) can keep up.
     if (typeof bot.entity.height !== 'number' || isNaN(bot.entity.height) || bot.entity.height < 0.1 || bot.entity.height > 1.65) {
@@ -281,21 +415,19 @@ function inject (bot) {
     lastSentYaw = (lastSentYaw + deltaYaw) % PI_2
     sentPosition.yaw = lastSentYaw
 
-    if (new Date() - lastFlyingUpdate > 1000) {
-      // Always send flying messages
+    // Only send location when alive though
+    if (bot.isAlive) {
+      sendMovement(sentPosition)
+    } else if (new Date() - lastFlyingUpdate > 1000) {
       // If you're dead, you're probably on the ground though ...
-      if (!bot.isAlive) bot.entity.onGround = true
+      bot.entity.onGround = true
       bot._client.write('flying', { onGround: bot.entity.onGround })
       lastFlyingUpdate = new Date()
     }
-
-    // Only send location when alive though
-    if (bot.isAlive) {
-      sendPositionAndLook(sentPosition)
-    }
   }
 
   bot.physics = physics
+  bot.simulate = simulate
 
   bot.setControlState = function setControlState (control, state) {
     assert.ok(control in controlState, `invalid control: ${control}`)
@@ -304,18 +436,8 @@ function inject (bot) {
     controlState[control] = state
     if (control === 'jump' && state) {
       jumpQueued = true
-    } else if (control === 'sprint') {
-      bot._client.write('entity_action', {
-        entityId: bot.entity.id,
-        actionId: state ? 3 : 4,
-        jumpBoost: 0
-      })
-    } else if (control === 'sneak') {
-      bot._client.write('entity_action', {
-        entityId: bot.entity.id,
-        actionId: state ? 0 : 1,
-        jumpBoost: 0
-      })
+    } else if (control === 'sprint' || control === 'sneak') {
+      sendAction(control)
     }
   }
 
@@ -355,7 +477,14 @@ function inject (bot) {
         cb()
       }
     }
-    if (haveCb) bot.on('move', checkYaw)
+    if (!haveCb) return
+    const sentYawDelta = math.euclideanMod(lastMove.yaw - conv.toNotchianYaw(yaw), 360)
+    if ((sentYawDelta < 0.001 || sentYawDelta > 360 - 0.001) && lastMove.pitch === conv.toNotchianPitch(pitch)) {
+      // that look was already sent, no "move" will come for it
+      process.nextTick(cb)
+      return
+    }
+    bot.on('move', checkYaw)
   }
 
   bot.lookAt = (point, force, cb) => {
@@ -368,11 +497,12 @@ function inject (bot) {
 
   // player position and look
   bot._client.on('position', (packet) => {
-    if (positionUpdateTimer === null) {
+    if (!positionUpdatesRunning) {
       // got first 0x0d. start the clocks
       bot.entity.yaw = conv.fromNotchianYaw(packet.yaw)
       bot.entity.pitch = conv.fromNotchianPitch(packet.pitch)
-      positionUpdateTimer = setInterval(sendPosition, POSITION_UPDATE_INTERVAL_MS)
+      scheduler.addTask(sendPosition)
+      positionUpdatesRunning = true
     }
 
     bot.entity.velocity.set(0, 0, 0)
@@ -388,20 +518,36 @@ function inject (bot) {
 
     if (bot.majorVersion === '1.9' || bot.majorVersion === '1.10' || bot.majorVersion === '1.11' || bot.majorVersion === '1.12' || bot.majorVersion === '1.13') {
       bot._client.write('teleport_confirm', { teleportId: packet.teleportId })
-      bot.emit('move')
+      const { x, y, z } = bot.entity.position
+      emitMove(x, y, z, conv.toNotchianYaw(bot.entity.yaw), conv.toNotchianPitch(bot.entity.pitch))
     }
 
-    if (doPhysicsTimer === null) {
+    if (!physicsRunning) {
       bot.entity.timeSinceOnGround = 0
       lastSentYaw = math.euclideanMod(bot.entity.yaw, PI_2)
       lastPositionSentTime = new Date()
-      lastPhysicsFrameTime = new Date()
-      doPhysicsTimer = setInterval(doPhysics, PHYSICS_INTERVAL_MS)
+      lastPhysicsFrameTime = Date.now()
+      physicsTimeAccumulator = 0
+      scheduler.addTask(doPhysics)
+      physicsRunning = true
     }
     bot.emit('forcedMove')
   })
 
+  // the server stops sprinting and sneaking when the player dies or respawns
+  function resetActions () {
+    lastSent.sprint = false
+    lastSent.sneak = false
+  }
+
   bot.on('mount', stopPhysics)
-  bot.on('respawn', stopPhysics)
+  bot.on('death', resetActions)
+  bot.on('respawn', () => {
+    stopPhysics()
+    resetActions()
+    // the controls still held are sent again
+    sendAction('sprint')
+    sendAction('sneak')
+  })
   bot.on('end', cleanup)
 }
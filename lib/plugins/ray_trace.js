@@ -1,27 +1,31 @@
 const Vec3 = require('vec3')
+const raycast = require('../raycast')
 
 module.exports = inject
 
-function inject (bot) {
+function inject (bot, { version }) {
+  const blockStates = require('../block_states')(version)
+
   const rayTraceBlock = (maxSteps = 256, vectorLength = 5 / 16) => {
     const { height, position, yaw, pitch } = bot.entity
-    const cursor = position.offset(0, height, 0)
+    const eye = position.offset(0, height, 0)
 
     const x = -Math.sin(yaw) * Math.cos(pitch)
     const y = Math.sin(pitch)
     const z = -Math.cos(yaw) * Math.cos(pitch)
 
-    const step = new Vec3(x, y, z).scaled(vectorLength)
+    const hit = raycast(eye, new Vec3(x, y, z), maxSteps * vectorLength, (x, y, z) => {
+      const stateId = bot.blockStateAt(x, y, z)
+      return stateId !== null && blockStates.blocksSight(stateId)
+    })
+    if (!hit) return undefined
 
-    for (let i = 0; i < maxSteps; ++i) {
-      cursor.add(step)
+    // the boxes of minecraft-data fill the whole block, so the ray enters the box where it enters the block
 
-      // TODO: Check boundingBox of block
-      const block = bot.blockAt(cursor)
-      if (block && block.type !== 0) {
-        return block
-      }
-    }
+    const block = bot.blockAt(hit.position)
+    block.face = hit.face
+    block.intersect = hit.intersect
+    return block
   }
 
   bot.blockInSight = rayTraceBlock
@@ -0,0 +1,75 @@
+const { Vec3 } = require('vec3')
+
+module.exports = raycast
+
+// faces as numbered by the protocol (block_dig, block_place)
+const FACE_BOTTOM = 0
+const FACE_TOP = 1
+const FACE_NORTH = 2
+const FACE_SOUTH = 3
+const FACE_WEST = 4
+const FACE_EAST = 5
+
+/**
+ * Walks the blocks crossed by a ray in order, visiting each of them exactly once
+ * (Amanatides & Woo, "A Fast Voxel Traversal Algorithm for Ray Tracing"), and
+ * stops at the first one for which isHit returns true.
+ * @param  {Vec3} from start of the ray
+ * @param  {Vec3} direction direction of the ray, doesn't need to be normalized
+ * @param  {Number} maxDistance length of the ray, in blocks
+ * @param  {Function} isHit called with the integer (x, y, z) of each block on the way
+ * @return {Object|null} { position, face, intersect } of the hit block: face is the
+ * face the ray entered it through (-1 for the block containing from) and intersect
+ * is the point where it did, null if nothing was hit
+ */
+function raycast (from, direction, maxDistance, isHit) {
+  const length = Math.sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z)
+  if (length === 0) return null
+  const dirX = direction.x / length
+  const dirY = direction.y / length
+  const dirZ = direction.z / length
+
+  let x = Math.floor(from.x)
+  let y = Math.floor(from.y)
+  let z = Math.floor(from.z)
+  const stepX = Math.sign(dirX)
+  const stepY = Math.sign(dirY)
+  const stepZ = Math.sign(dirZ)
+  // distance along the ray to go through a whole block on each axis
+  const deltaX = stepX === 0 ? Infinity : Math.abs(1 / dirX)
+  const deltaY = stepY === 0 ? Infinity : Math.abs(1 / dirY)
+  const deltaZ = stepZ === 0 ? Infinity : Math.abs(1 / dirZ)
+  // distance along the ray to the next block boundary on each axis
+  let nextX = stepX > 0 ? (x + 1 - from.x) * deltaX : stepX < 0 ? (from.x - x) * deltaX : Infinity
+  let nextY = stepY > 0 ? (y + 1 - from.y) * deltaY : stepY < 0 ? (from.y - y) * deltaY : Infinity
+  let nextZ = stepZ > 0 ? (z + 1 - from.z) * deltaZ : stepZ < 0 ? (from.z - z) * deltaZ : Infinity
+
+  let distance = 0
+  let face = -1
+  while (distance <= maxDistance) {
+    if (isHit(x, y, z)) {
+      return {
+        position: new Vec3(x, y, z),
+        face,
+        intersect: new Vec3(from.x + dirX * distance, from.y + dirY * distance, from.z + dirZ * distance)
+      }
+    }
+    if (nextX < nextY && nextX < nextZ) {
+      x += stepX
+      distance = nextX
+      nextX += deltaX
+      face = stepX > 0 ? FACE_WEST : FACE_EAST
+    } else if (nextY < nextZ) {
+      y += stepY
+      distance = nextY
+      nextY += deltaY
+      face = stepY > 0 ? FACE_BOTTOM : FACE_TOP
+    } else {
+      z += stepZ
+      distance = nextZ
+      nextZ += deltaZ
+      face = stepZ > 0 ? FACE_NORTH : FACE_SOUTH
+    }
+  }
+  return null
+}
@@ -0,0 +1,30 @@
+// a single timer shared by all the bots of the process, calling the
+// registered tasks every TICK_MS instead of each bot having its own intervals
+
+const TICK_MS = 50
+
+const tasks = new Set()
+let timer = null
+
+function runTasks () {
+  for (const task of tasks) task()
+}
+
+function addTask (task) {
+  tasks.add(task)
+  if (timer === null) timer = setInterval(runTasks, TICK_MS)
+}
+
+function removeTask (task) {
+  tasks.delete(task)
+  if (tasks.size === 0 && timer !== null) {
+    clearInterval(timer)
+    timer = null
+  }
+}
+
+module.exports = {
+  TICK_MS,
+  addTask,
+  removeTask
+}
@@ -0,0 +1,69 @@
+/**
+ * Chunk storage that can be shared by several bots of the same process.
+ * Pass the same instance as the `world` option of createBot so bots in the
+ * same dimension share their chunk columns, block entities and signs instead
+ * of each keeping (and decoding) a copy.
+ */
+class World {
+  constructor () {
+    this.stores = new Map()
+  }
+
+  /**
+   * Returns the storage for a minecraft version and a dimension
+   * @param  {String} version
+   * @param  {Number} dimension
+   * @return {WorldStore}
+   */
+  store (version, dimension) {
+    const key = `${version}:${dimension}`
+    let store = this.stores.get(key)
+    if (!store) {
+      store = new WorldStore()
+      this.stores.set(key, store)
+    }
+    return store
+  }
+}
+
+class WorldStore {
+  constructor () {
+    // columns are keyed by their chunk coordinates, see columnKey
+    this.columns = new Map()
+    // with lazyChunkLoading, the map_chunk data of columns that were not read yet
+    // column key -> list of addColumn arguments to load in order
+    this.pendingColumns = new Map()
+    // column key -> number of bots holding that column
+    this.holders = new Map()
+    // column key -> Map(block key -> sign or block entity), see blockKey
+    this.signs = new Map()
+    this.blockEntities = new Map()
+  }
+
+  // true if another holder than the caller already has that column
+  isHeld (key) {
+    return this.holders.has(key)
+  }
+
+  acquire (key) {
+    this.holders.set(key, (this.holders.get(key) || 0) + 1)
+  }
+
+  // the column is freed once nobody holds it anymore
+  release (key) {
+    const count = (this.holders.get(key) || 0) - 1
+    if (count > 0) {
+      this.holders.set(key, count)
+      return
+    }
+    this.holders.delete(key)
+    this.columns.delete(key)
+    this.pendingColumns.delete(key)
+    this.signs.delete(key)
+    this.blockEntities.delete(key)
+  }
+}
+
+World.WorldStore = WorldStore
+
+module.exports = World
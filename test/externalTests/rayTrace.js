@@ -10,7 +10,11 @@ module.exports = () => (bot, done) => {
       const block = bot.blockInSight()
       const relBlock = bot.blockAt(position.offset(0, -1, 0))
 
-      assert.deepStrictEqual(block, relBlock)
+      assert.deepStrictEqual(block.position, relBlock.position)
+      assert.strictEqual(block.type, relBlock.type)
+      // the ray goes down so it enters the block through its top face
+      assert.strictEqual(block.face, 1)
+      assert.ok(block.intersect.y >= relBlock.position.y + 1 - 1e-9)
       done()
     })
   })
@@ -60,6 +60,49 @@ mineflayer.testedVersions.forEach((supportedVersion, i) => {
         })
       })
     })
+    it('chat patterns', (done) => {
+      const matched = []
+      bot.chatAddPattern(/^\[Party\] (\w+): (.*)$/, 'party')
+      bot.chatAddPattern(/^\[Guild\] (\w+): (.*)$/, 'guild')
+      bot.chatAddPattern(/(\w+) joined the party$/, 'partyJoin')
+      bot.on('party', (username, message) => matched.push(['party', username, message]))
+      bot.on('guild', () => matched.push(['guild']))
+      bot.on('partyJoin', (username) => matched.push(['partyJoin', username]))
+      bot.once('unmachedMessage', (message) => {
+        assert.strictEqual(message, 'nothing to see')
+        assert.deepStrictEqual(matched, [['party', 'gary', 'hello'], ['partyJoin', 'bob']])
+        done()
+      })
+      server.on('login', (client) => {
+        for (const text of ['[Party] gary: hello', 'bob joined the party', 'nothing to see']) {
+          client.write('chat', { message: JSON.stringify({ text }), position: 0 })
+        }
+      })
+    })
+    it('chat patterns changed in place are recompiled', (done) => {
+      const matched = []
+      bot.chatAddPattern(/^\[Party\] (\w+): (.*)$/, 'party')
+      bot.on('party', (username, message) => matched.push([username, message]))
+      bot.on('partyMessage', (username, message) => matched.push(['partyMessage', username, message]))
+      const unmatched = []
+      bot.on('unmachedMessage', (message) => {
+        unmatched.push(message)
+        if (message !== 'nothing to see') return
+        assert.deepStrictEqual(matched, [['gary', 'hello'], ['partyMessage', 'bob', 'hi']])
+        assert.deepStrictEqual(unmatched, ['[Party] gary: hello again', 'nothing to see'])
+        done()
+      })
+      server.on('login', (client) => {
+        client.write('chat', { message: JSON.stringify({ text: '[Party] gary: hello' }), position: 0 })
+        bot.once('party', () => {
+          bot.chatPatterns[bot.chatPatterns.length - 1].pattern = /^\(Party\) (\w+): (.*)$/
+          bot.chatPatterns[bot.chatPatterns.length - 1].type = 'partyMessage'
+          for (const text of ['[Party] gary: hello again', '(Party) bob: hi', 'nothing to see']) {
+            client.write('chat', { message: JSON.stringify({ text }), position: 0 })
+          }
+        })
+      })
+    })
     it('entity effects', (done) => {
       bot.once('entityEffect', (entity, effect) => {
         assert.strictEqual(entity.id, 8)
@@ -129,6 +172,200 @@ mineflayer.testedVersions.forEach((supportedVersion, i) => {
         })
       })
     })
+    it('blocks without a bounding box are seen through', (done) => {
+      const stone = mcData.blocksByName.stone.id
+      const torch = mcData.blocksByName.torch.id
+      bot.once('forcedMove', () => {
+        bot.entity.yaw = 0
+        bot.entity.pitch = -Math.PI / 2
+        const seen = bot.blockInSight()
+        assert.strictEqual(seen.type, stone)
+        assert.ok(seen.position.equals(vec3(0, 62, 0)))
+        assert.strictEqual(seen.face, 1)
+        assert.ok(Math.abs(seen.intersect.y - 63) < 1e-9)
+        assert.strictEqual(bot.canSeeBlock(bot.blockAt(vec3(0, 62, 0))), true)
+        // the stone block right under it is hidden
+        assert.strictEqual(bot.canSeeBlock(bot.blockAt(vec3(0, 61, 0))), false)
+        done()
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        const chunk = new Chunk()
+        chunk.setBlockType(vec3(0, 63, 0), torch)
+        chunk.setBlockType(vec3(0, 62, 0), stone)
+        chunk.setBlockType(vec3(0, 61, 0), stone)
+        client.write('map_chunk', {
+          x: 0,
+          z: 0,
+          groundUp: true,
+          bitMap: chunk.getMask(),
+          chunkData: chunk.dump(),
+          blockEntities: []
+        })
+        client.write('position', { x: 0.5, y: 64, z: 0.5, yaw: 0, pitch: 0, flags: 0, teleportId: 0 })
+      })
+    })
+
+    it('blockStateAt', (done) => {
+      const pos = vec3(1, 65, 1)
+      const goldId = 41
+      const chunk = new Chunk()
+      chunk.setBlockType(pos, goldId)
+      bot.on('chunkColumnLoad', () => {
+        assert.strictEqual(bot.blockStateAt(pos.x, pos.y, pos.z), chunk.getBlockStateId(pos))
+        assert.strictEqual(bot.blockAtXYZ(pos.x + 0.5, pos.y, pos.z).type, goldId)
+        assert.strictEqual(bot.blockStateAt(-1, pos.y, pos.z), null)
+        assert.strictEqual(bot.blockAtXYZ(pos.x, 300, pos.z), null)
+        done()
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        client.write('map_chunk', {
+          x: 0,
+          z: 0,
+          groundUp: true,
+          bitMap: chunk.getMask(),
+          chunkData: chunk.dump(),
+          blockEntities: []
+        })
+      })
+    })
+    it('findBlocks returns the nearest blocks first', (done) => {
+      const goldId = 41
+      const far = vec3(1, 65, 1)
+      const near = vec3(8, 70, 8)
+      const chunk = new Chunk()
+      chunk.setBlockType(far, goldId)
+      chunk.setBlockType(near, goldId)
+      bot.on('chunkColumnLoad', () => {
+        const point = vec3(8, 69, 8)
+        const positions = bot.findBlocks({ point, matching: goldId, maxDistance: 32, count: 10 })
+        assert.strictEqual(positions.length, 2)
+        assert.ok(positions[0].equals(near))
+        assert.ok(positions[1].equals(far))
+        assert.ok(bot.findBlock({ point, matching: goldId, maxDistance: 32 }).position.equals(near))
+        assert.strictEqual(bot.findBlock({ point, matching: goldId, maxDistance: 0.5 }), null)
+        done()
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        client.write('map_chunk', {
+          x: 0,
+          z: 0,
+          groundUp: true,
+          bitMap: chunk.getMask(),
+          chunkData: chunk.dump(),
+          blockEntities: []
+        })
+      })
+    })
+    it('findBlocks keeps the nearest blocks across sections', (done) => {
+      const goldId = 41
+      const point = vec3(8, 40, 8)
+      // scanned in that order: the second section found already has count matches, but not the nearest ones
+      const farInSection = vec3(0, 32, 0)
+      const nearest = vec3(8, 47, 8)
+      const nextSection = vec3(8, 49, 8)
+      const farther = vec3(8, 20, 8)
+      const chunk = new Chunk()
+      for (const position of [farInSection, nearest, nextSection, farther]) chunk.setBlockType(position, goldId)
+      bot.on('chunkColumnLoad', () => {
+        const positions = bot.findBlocks({ point, matching: goldId, maxDistance: 32, count: 2 })
+        assert.strictEqual(positions.length, 2)
+        assert.ok(positions[0].equals(nearest))
+        assert.ok(positions[1].equals(nextSection))
+        const three = bot.findBlocks({ point, matching: goldId, maxDistance: 32, count: 3 })
+        assert.ok(three[2].equals(farInSection))
+        done()
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        client.write('map_chunk', {
+          x: 0,
+          z: 0,
+          groundUp: true,
+          bitMap: chunk.getMask(),
+          chunkData: chunk.dump(),
+          blockEntities: []
+        })
+      })
+    })
+    it('blockUpdateBatch', (done) => {
+      const goldId = 41
+      const pos = vec3(1, 65, 1)
+      const chunk = new Chunk()
+      chunk.setBlockType(pos, goldId)
+      const goldStateId = chunk.getBlockStateId(pos)
+      bot.once('chunkColumnLoad', () => {
+        bot.once('blockUpdateBatch', (changes) => {
+          assert.strictEqual(changes.length, 10)
+          assert.deepStrictEqual(Array.from(changes.slice(0, 5)), [1, 65, 1, goldStateId, 0])
+          assert.deepStrictEqual(Array.from(changes.slice(5, 10)), [2, 66, 3, 0, goldStateId])
+          assert.strictEqual(bot.blockStateAt(1, 65, 1), 0)
+          assert.strictEqual(bot.blockStateAt(2, 66, 3), goldStateId)
+          done()
+        })
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        client.write('map_chunk', {
+          x: 0,
+          z: 0,
+          groundUp: true,
+          bitMap: chunk.getMask(),
+          chunkData: chunk.dump(),
+          blockEntities: []
+        })
+        client.write('multi_block_change', {
+          chunkX: 0,
+          chunkZ: 0,
+          records: [
+            { horizontalPos: (1 << 4) | 1, y: 65, blockId: 0 },
+            { horizontalPos: (2 << 4) | 3, y: 66, blockId: goldStateId }
+          ]
+        })
+      })
+    })
     describe('physics', () => {
       const pos = vec3(1, 65, 1)
       const goldId = 41
@@ -183,6 +420,45 @@ mineflayer.testedVersions.forEach((supportedVersion, i) => {
         })
       })
     })
+    it('simulate', (done) => {
+      const pos = vec3(1, 65, 1)
+      const goldId = 41
+      const chunk = new Chunk()
+      chunk.setBlockType(pos, goldId)
+      bot.on('chunkColumnLoad', () => {
+        const state = {
+          position: vec3(1.5, 70, 1.5),
+          velocity: vec3(0, 0, 0),
+          yaw: 0,
+          onGround: false,
+          timeSinceOnGround: 0
+        }
+        const landed = bot.simulate(state, {}, 40)
+        assert.ok(landed.onGround)
+        assert.ok(Math.abs(landed.position.y - (pos.y + 1)) < 0.01)
+        assert.strictEqual(state.position.y, 70)
+        done()
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        client.write('map_chunk', {
+          x: 0,
+          z: 0,
+          groundUp: true,
+          bitMap: chunk.getMask(),
+          chunkData: chunk.dump(),
+          blockEntities: []
+        })
+      })
+    })
     describe('entities', () => {
       it('player displayName', (done) => {
         server.on('login', (client) => {
@@ -350,6 +626,1053 @@ mineflayer.testedVersions.forEach((supportedVersion, i) => {
       })
     })
 
+    it('nearestEntity and entitiesWithin', (done) => {
+      const entities = mcData.entitiesByName
+      const creeperId = entities.creeper ? entities.creeper.id : entities.Creeper.id
+      // 1.8 sends fixed point positions
+      const scale = version.majorVersion === '1.8' ? 32 : 1
+      const indexed = mineflayer.createBot({ username: 'indexed', version: supportedVersion, port: 25567, entityIndex: true })
+      indexed.on('entitySpawn', (entity) => {
+        if (entity.id !== 10) return
+        assert.strictEqual(indexed.nearestEntity().id, 8)
+        assert.strictEqual(indexed.nearestEntity(entity => entity.id !== 8).id, 10)
+        assert.strictEqual(indexed.nearestEntity(entity => entity.id === 42), null)
+        const within = indexed.entitiesWithin(indexed.entities[10].position.x)
+        assert.deepStrictEqual(within.map(entity => entity.id), [8, 10])
+      })
+      indexed.on('entityMoved', (entity) => {
+        // from the column at x 96 to the one of the bot
+        assert.strictEqual(entity.id, 9)
+        assert.strictEqual(indexed.nearestEntity().id, 9)
+        assert.deepStrictEqual(indexed.entitiesWithin(20).map(entity => entity.id), [9, 8])
+        indexed.end()
+        done()
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        if (client.username !== 'indexed') return
+        for (const [entityId, x] of [[8, 10], [9, 100], [10, 50]]) {
+          client.write('spawn_entity_living', {
+            entityId,
+            entityUUID: '00112233-4455-6677-8899-aabbccddeeff',
+            type: creeperId,
+            x: x * scale,
+            y: 0,
+            z: 0,
+            yaw: 0,
+            pitch: 0,
+            headPitch: 0,
+            velocityX: 0,
+            velocityY: 0,
+            velocityZ: 0,
+            metadata: []
+          })
+        }
+        client.write('entity_teleport', { entityId: 9, x: 5 * scale, y: 0, z: 0, yaw: 0, pitch: 0, onGround: true })
+      })
+    })
+
+    it('instrumentation attributes listeners to plugins', () => {
+      const EventEmitter = require('events')
+      const instrument = require('../lib/instrumentation')
+      const bot = new EventEmitter()
+      const client = new EventEmitter()
+      const instrumentation = instrument(bot)
+      instrumentation.attachClient(client)
+      instrumentation.setPlugin('blocks')
+      client.on('map_chunk', () => bot.emit('chunkColumnLoad'))
+      const onSpawn = () => {}
+      bot.once('spawn', onSpawn)
+      instrumentation.setPlugin(null)
+      bot.on('chunkColumnLoad', () => {})
+      bot.once('blockUpdate:(1, 2, 3)', () => {})
+      bot.once('blockUpdate:(4, 5, 6)', () => {})
+      bot.once('confirmTransaction12', () => {})
+      client.emit('map_chunk')
+      client.emit('map_chunk')
+      bot.removeListener('spawn', onSpawn)
+      bot.emit('spawn')
+      bot.emit('blockUpdate:(1, 2, 3)')
+      bot.emit('blockUpdate:(4, 5, 6)')
+      bot.emit('confirmTransaction12')
+      const stats = instrumentation.stats()
+      assert.deepStrictEqual(Object.keys(stats.plugins.blocks.handlers), ['client:map_chunk'])
+      assert.strictEqual(stats.plugins['(user)'].handlers['bot:chunkColumnLoad'].calls, 2)
+      // one entry for all the positions and ids
+      assert.deepStrictEqual(Object.keys(stats.plugins['(user)'].handlers), ['bot:chunkColumnLoad', 'bot:blockUpdate', 'bot:confirmTransaction'])
+      assert.strictEqual(stats.plugins['(user)'].handlers['bot:blockUpdate'].calls, 2)
+      assert.strictEqual(stats.packets.map_chunk.calls, 2)
+      instrumentation.resetStats()
+      assert.deepStrictEqual(instrumentation.stats().plugins, {})
+    })
+
+    it('lean clients only parse the packets listened to', () => {
+      const EventEmitter = require('events')
+      const skipUnusedPackets = require('../lib/packet_filter')
+      const mappings = mcData.protocol.play.toClient.types.packet[1][0].type[1].mappings
+      const idOf = name => parseInt(Object.keys(mappings).find(id => mappings[id] === name))
+      const client = new EventEmitter()
+      client.state = 'play'
+      const parsed = []
+      client.deserializer = { parsePacketBuffer: buffer => { parsed.push(buffer[0]) } }
+      skipUnusedPackets(client, supportedVersion)
+      client.on('spawn_entity', () => {})
+      client.deserializer.parsePacketBuffer(Buffer.from([idOf('spawn_entity'), 0]))
+      const skipped = client.deserializer.parsePacketBuffer(Buffer.from([idOf('sound_effect'), 0]))
+      assert.deepStrictEqual(parsed, [idOf('spawn_entity')])
+      assert.deepStrictEqual(skipped.data, { name: 'sound_effect', params: {} })
+    })
+
+    it('chunk cache keeps columns for the next session', (done) => {
+      const fs = require('fs')
+      const os = require('os')
+      const path = require('path')
+      const ChunkCache = require('../lib/chunk_cache')
+      const { columnKey } = require('../lib/chunk_sections')
+      const directory = path.join(os.tmpdir(), `mineflayer-chunk-cache-${process.pid}`)
+      const column = new Chunk()
+      column.setBlockType(vec3(1, 2, 3), 5)
+      const cache = new ChunkCache(directory, 'localhost:25567')
+      cache.use(supportedVersion, 0)
+      cache.writeColumn(-2, 3, column, true, () => {
+        try {
+          const nextSession = new ChunkCache(directory, 'localhost:25567')
+          nextSession.use(supportedVersion, 0)
+          assert.ok(nextSession.has(columnKey(-2, 3)))
+          const args = nextSession.read(-2, 3)
+          const loaded = new Chunk()
+          loaded.load(args.data, args.bitMap, args.skyLightSent)
+          assert.strictEqual(loaded.getBlockType(vec3(1, 2, 3)), 5)
+          // a column cut short by a crash isn't read back
+          const file = nextSession.file(-2, 3)
+          fs.truncateSync(file, fs.statSync(file).size - 1)
+          assert.strictEqual(nextSession.read(-2, 3), null)
+        } finally {
+          fs.rmSync(directory, { recursive: true, force: true })
+        }
+        done()
+      })
+    })
+
+    it('packet recordings can be replayed', (done) => {
+      const os = require('os')
+      const path = require('path')
+      const file = path.join(os.tmpdir(), `mineflayer-recording-${process.pid}.bin`)
+      const recording = mineflayer.recordPackets(bot, file)
+      bot.once('chat', () => {
+        recording.stop(() => {
+          const client = mineflayer.createReplayClient(file, { speed: Infinity })
+          const replayed = mineflayer.createBot({ client })
+          replayed.once('chat', (username, message) => {
+            assert.strictEqual(username, 'gary')
+            assert.strictEqual(message, 'hello')
+            replayed.on('end', () => {
+              require('fs').unlinkSync(file)
+              done()
+            })
+          })
+        })
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        const message = JSON.stringify({ translate: 'chat.type.text', with: [{ text: 'gary' }, 'hello'] })
+        client.write('chat', { message, position: 0 })
+      })
+    })
+
+    it('fleet proxies pass callbacks where the methods expect them', () => {
+      const { CALLBACK_POSITIONS, withCallback } = require('../lib/fleet_protocol')
+      const cb = () => {}
+      const point = vec3(1, 2, 3)
+      assert.deepStrictEqual(withCallback([point], CALLBACK_POSITIONS.lookAt, cb), [point, undefined, cb])
+      assert.deepStrictEqual(withCallback([point, true], CALLBACK_POSITIONS.lookAt, cb), [point, true, cb])
+      assert.deepStrictEqual(withCallback([0, 1], CALLBACK_POSITIONS.look, cb), [0, 1, undefined, cb])
+      // and not in force, where appending it would put it
+      const lookAt = (point, force, callback) => callback
+      assert.strictEqual(lookAt(...withCallback([point], CALLBACK_POSITIONS.lookAt, cb)), cb)
+    })
+
+    it('fleet proxies only subscribe to the events they listen to', () => {
+      const { BotProxy } = require('../lib/fleet')
+      const messages = []
+      const proxy = new BotProxy({ postMessage: message => messages.push(message) }, 3, {})
+      const onMove = () => {}
+      proxy.on('entityMoved', onMove)
+      proxy.on('entityMoved', () => {})
+      proxy.once('chat', () => {})
+      proxy.on('end', () => {})
+      assert.deepStrictEqual(messages, [
+        { type: 'subscribe', botId: 3, event: 'entityMoved' },
+        { type: 'subscribe', botId: 3, event: 'chat' }
+      ])
+      proxy.removeListener('entityMoved', onMove)
+      assert.strictEqual(messages.length, 2)
+      proxy.removeAllListeners('entityMoved')
+      proxy.emit('chat', 'gary', 'hello')
+      assert.deepStrictEqual(messages.slice(2), [
+        { type: 'unsubscribe', botId: 3, event: 'entityMoved' },
+        { type: 'unsubscribe', botId: 3, event: 'chat' }
+      ])
+    })
+
+    it('only the movement that changed is sent', () => {
+      const { movementPacketName } = require('../lib/movement_packets')
+      const lastSent = { x: 0, y: 64, z: 0, yaw: 0, pitch: 0, onGround: true }
+      const at = (changes) => Object.assign({}, lastSent, changes)
+      assert.strictEqual(movementPacketName(lastSent, at({}), false), null)
+      assert.strictEqual(movementPacketName(lastSent, at({}), true), 'position')
+      assert.strictEqual(movementPacketName(lastSent, at({ x: 0.02 }), false), null)
+      assert.strictEqual(movementPacketName(lastSent, at({ x: 0.5 }), false), 'position')
+      assert.strictEqual(movementPacketName(lastSent, at({ yaw: 90 }), false), 'look')
+      assert.strictEqual(movementPacketName(lastSent, at({ x: 0.5, pitch: 10 }), false), 'position_look')
+      assert.strictEqual(movementPacketName(lastSent, at({ yaw: 90 }), true), 'position_look')
+      assert.strictEqual(movementPacketName(lastSent, at({ onGround: false }), false), 'flying')
+      assert.strictEqual(movementPacketName(lastSent, at({ x: 0.02, onGround: false }), false), 'flying')
+    })
+
+    it('move is only emitted when the bot moved or turned', (done) => {
+      bot.once('forcedMove', () => {
+        let moves = 0
+        bot.on('move', () => moves++)
+        setTimeout(() => {
+          // standing still on the block
+          assert.strictEqual(moves, 0)
+          bot.look(1, 0.5, true, () => {
+            assert.strictEqual(moves, 1)
+            // nothing left to send, the callback doesn't wait for a "move"
+            bot.look(1, 0.5, true, () => {
+              assert.strictEqual(moves, 1)
+              done()
+            })
+          })
+        }, 300)
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        const chunk = new Chunk()
+        chunk.setBlockType(vec3(0, 63, 0), mcData.blocksByName.stone.id)
+        client.write('map_chunk', {
+          x: 0,
+          z: 0,
+          groundUp: true,
+          bitMap: chunk.getMask(),
+          chunkData: chunk.dump(),
+          blockEntities: []
+        })
+        client.write('position', { x: 0.5, y: 64, z: 0.5, yaw: 0, pitch: 0, flags: 0, teleportId: 0 })
+      })
+    })
+
+    it('sprinting is sent right away and again after respawning', (done) => {
+      bot.once('login', () => bot.setControlState('sprint', true))
+      server.on('login', (client) => {
+        let actions = 0
+        client.on('entity_action', (packet) => {
+          assert.strictEqual(packet.actionId, 3)
+          if (++actions === 1) {
+            client.write('respawn', { dimension: 0, difficulty: 0, gamemode: 0, levelType: 'default' })
+          } else {
+            done()
+          }
+        })
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+      })
+    })
+
+    it('digQueue waits for the damage of the held tool before swapping tools', (done) => {
+      const Item = require('prismarine-item')(supportedVersion)
+      const shovel = new Item(mcData.itemsByName.wooden_shovel.id, 1)
+      const pickaxe = new Item(mcData.itemsByName.wooden_pickaxe.id, 1)
+      const dirt = vec3(1, 64, 0)
+      const stone = vec3(2, 64, 0)
+      const chunk = new Chunk()
+      for (let x = 0; x < 16; x++) {
+        for (let z = 0; z < 16; z++) chunk.setBlockType(vec3(x, 63, z), mcData.blocksByName.stone.id)
+      }
+      chunk.setBlockType(dirt, mcData.blocksByName.dirt.id)
+      chunk.setBlockType(stone, mcData.blocksByName.stone.id)
+      bot.once('forcedMove', () => {
+        // the shovel digs the dirt, then the pickaxe from the main inventory is swapped in for the stone
+        bot.digQueue([dirt, stone], () => {})
+      })
+      server.on('login', (client) => {
+        let damageSent = false
+        client.on('block_dig', (packet) => {
+          if (packet.status !== 2) return
+          setTimeout(() => {
+            damageSent = true
+            const damaged = new Item(shovel.type, 1, 1)
+            client.write('set_slot', { windowId: 0, slot: 36, item: Item.toNotch(damaged) })
+          }, 100)
+        })
+        client.on('window_click', (packet) => {
+          assert.ok(damageSent)
+          assert.strictEqual(packet.slot, 9)
+          assert.strictEqual(packet.mode, 2)
+          done()
+        })
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        client.write('map_chunk', {
+          x: 0,
+          z: 0,
+          groundUp: true,
+          bitMap: chunk.getMask(),
+          chunkData: chunk.dump(),
+          blockEntities: []
+        })
+        const items = []
+        for (let i = 0; i < bot.inventory.slots.length; i++) items.push(Item.toNotch(i === 36 ? shovel : i === 9 ? pickaxe : null))
+        client.write('window_items', { windowId: 0, items })
+        client.write('held_item_slot', { slot: 0 })
+        client.write('position', { x: 0.5, y: 64, z: 0.5, yaw: 0, pitch: 0, flags: 0, teleportId: 0 })
+      })
+    })
+
+    it('bots sharing a world keep their own block index up to date', (done) => {
+      const goldId = 41
+      const chunk = new Chunk()
+      chunk.setBlockType(vec3(1, 64, 1), goldId)
+      const goldStateId = chunk.getBlockStateId(vec3(1, 64, 1))
+      const world = new mineflayer.World()
+      const bots = [0, 1].map(i => mineflayer.createBot({
+        username: `shared${i}`,
+        version: supportedVersion,
+        port: 25567,
+        world,
+        indexedBlocks: [goldId]
+      }))
+      const clients = []
+      let loaded = 0
+      let updated = 0
+      for (const sharedBot of bots) {
+        sharedBot.once('chunkColumnLoad', () => {
+          if (++loaded < bots.length) return
+          // the first bot applies it to the shared column, the second one sees no change in it
+          for (const client of clients) client.write('block_change', { location: { x: 2, y: 64, z: 2 }, type: goldStateId })
+        })
+        sharedBot.on('blockUpdateBatch', () => {
+          if (++updated < bots.length) return
+          for (const other of bots) {
+            assert.strictEqual(other.blockIndex.positions(goldId).length, 2)
+            other.end()
+          }
+          done()
+        })
+      }
+      server.on('login', (client) => {
+        if (client.username !== 'player') clients.push(client)
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        client.write('map_chunk', {
+          x: 0,
+          z: 0,
+          groundUp: true,
+          bitMap: chunk.getMask(),
+          chunkData: chunk.dump(),
+          blockEntities: []
+        })
+      })
+    })
+
+    it('the item index follows the slots that change', () => {
+      const Item = require('prismarine-item')(supportedVersion)
+      const windows = require('prismarine-windows')(supportedVersion).windows
+      const indexWindow = require('../lib/item_index')
+      const window = indexWindow(new windows.InventoryWindow(0, 'Inventory', version.majorVersion === '1.8' ? 45 : 46), windows.INVENTORY_SLOT_COUNT)
+      const stone = mcData.blocksByName.stone.id
+      const dirt = mcData.blocksByName.dirt.id
+      window.updateSlot(36, new Item(stone, 10))
+      window.updateSlot(37, new Item(stone, 5))
+      assert.strictEqual(window.count(stone), 15)
+      // picking up the first stack and putting it down before the second one
+      window.acceptClick({ slot: 36, mouseButton: 0, mode: 0 })
+      assert.strictEqual(window.count(stone), 5)
+      window.acceptClick({ slot: 20, mouseButton: 0, mode: 0 })
+      assert.strictEqual(window.count(stone), 15)
+      assert.strictEqual(window.findInventoryItem(stone), window.slots[20])
+      window.updateSlot(20, new Item(dirt, 3))
+      assert.strictEqual(window.count(stone), 5)
+      assert.strictEqual(window.count(dirt), 3)
+      assert.strictEqual(window.findInventoryItem(stone), window.slots[37])
+      window.updateSlot(37, null)
+      assert.strictEqual(window.count(stone), 0)
+      assert.strictEqual(window.findInventoryItem(stone), null)
+    })
+
+    it('pipelined clicks are predicted and rolled back when rejected', (done) => {
+      const Item = require('prismarine-item')(supportedVersion)
+      const stone = mcData.blocksByName.stone.id
+      const dirt = mcData.blocksByName.dirt.id
+      const pipelined = mineflayer.createBot({ username: 'pipelined', version: supportedVersion, port: 25567, pipelineClicks: true })
+      pipelined.once('setWindowItems:0', () => {
+        const inventory = pipelined.inventory
+        // the server only answers the clicks on slot 36
+        inventory.transactionRequiresConfirmation = (click) => click.slot === 36
+        pipelined.clickWindow(36, 0, 0)
+        pipelined.clickWindow(37, 0, 0)
+        // both applied before the server answered
+        assert.strictEqual(inventory.slots[36], null)
+        assert.strictEqual(inventory.slots[37].type, stone)
+        assert.strictEqual(inventory.selectedItem.type, dirt)
+        pipelined.once('windowClicksSettled', (err) => {
+          assert.ok(err)
+          // the second click, that won't be answered, was undone with the first one
+          assert.strictEqual(inventory.slots[36].type, stone)
+          assert.strictEqual(inventory.slots[37].type, dirt)
+          assert.strictEqual(inventory.selectedItem, null)
+          // a click that won't be answered is final right away
+          pipelined.once('windowClicksSettled', (err) => {
+            assert.strictEqual(err, null)
+            assert.strictEqual(inventory.slots[37], null)
+            assert.strictEqual(inventory.selectedItem.type, dirt)
+            pipelined.end()
+            done()
+          })
+          pipelined.clickWindow(37, 0, 0)
+        })
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        if (client.username !== 'pipelined') return
+        client.on('window_click', (packet) => {
+          if (packet.slot === 36) client.write('transaction', { windowId: 0, action: packet.action, accepted: false })
+        })
+        const items = []
+        for (let i = 0; i < pipelined.inventory.slots.length; i++) {
+          items.push(Item.toNotch(i === 36 ? new Item(stone, 10) : i === 37 ? new Item(dirt, 3) : null))
+        }
+        client.write('window_items', { windowId: 0, items })
+        client.write('held_item_slot', { slot: 0 })
+      })
+    })
+
+    it('pipelined clicks are given up on when the server closes the window', (done) => {
+      const Item = require('prismarine-item')(supportedVersion)
+      const stone = mcData.blocksByName.stone.id
+      const dirt = mcData.blocksByName.dirt.id
+      const pipelined = mineflayer.createBot({ username: 'pipelined', version: supportedVersion, port: 25567, pipelineClicks: true })
+      pipelined.once('windowOpen', (chest) => {
+        chest.transactionRequiresConfirmation = () => true
+        pipelined.clickWindow(0, 0, 0)
+        assert.strictEqual(chest.slots[0], null)
+        pipelined.waitForTransactions((err) => {
+          assert.ok(err)
+          // the click was undone and the slot sent meanwhile applied
+          assert.strictEqual(chest.slots[0].type, stone)
+          assert.strictEqual(chest.selectedItem, null)
+          assert.strictEqual(pipelined.inventory.slots[36].type, dirt)
+          // and the next slots aren't held back anymore
+          pipelined.once('setSlot:0', () => {
+            assert.strictEqual(pipelined.currentWindow, null)
+            assert.strictEqual(pipelined.inventory.slots[37].type, dirt)
+            pipelined.end()
+            done()
+          })
+        })
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        if (client.username !== 'pipelined') return
+        client.once('window_click', () => {
+          // never answered
+          client.write('set_slot', { windowId: 0, slot: 36, item: Item.toNotch(new Item(dirt, 1)) })
+          client.write('close_window', { windowId: 1 })
+          client.write('set_slot', { windowId: 0, slot: 37, item: Item.toNotch(new Item(dirt, 1)) })
+        })
+        client.write('open_window', { windowId: 1, inventoryType: 'minecraft:chest', windowTitle: JSON.stringify('Chest'), slotCount: 27 })
+        const items = []
+        for (let i = 0; i < 27 + 36; i++) items.push(Item.toNotch(i === 0 ? new Item(stone, 10) : null))
+        client.write('window_items', { windowId: 1, items })
+      })
+    })
+
+    it('shift, hotbar and drag clicks are predicted where the server is known to agree', (done) => {
+      const Item = require('prismarine-item')(supportedVersion)
+      const stone = mcData.blocksByName.stone.id
+      const helmet = mcData.itemsByName.diamond_helmet.id
+      bot.once('setWindowItems:0', () => {
+        const inventory = bot.inventory
+        inventory.transactionRequiresConfirmation = () => true
+        // mode 1: the main inventory to the first empty hotbar slot
+        bot.clickWindow(9, 0, 1, (err) => {
+          assert.ifError(err)
+          // mode 2: hotbar slot 36 swapped with the hotbar key 1, slot 37
+          bot.clickWindow(36, 1, 2, (err) => {
+            assert.ifError(err)
+            bot.clickWindow(37, 0, 0, (err) => {
+              assert.ifError(err)
+              assert.strictEqual(inventory.selectedItem.count, 10)
+              // mode 5: the held stack spread over the slots 12 and 13
+              bot.clickWindow(-999, 0, 5)
+              bot.clickWindow(12, 1, 5)
+              bot.clickWindow(13, 1, 5)
+              bot.clickWindow(-999, 2, 5, (err) => {
+                assert.ifError(err)
+                // armor pieces are shift clicked to the armor slots, that's left to the server
+                bot.clickWindow(10, 0, 1, (err) => {
+                  assert.ifError(err)
+                  assert.strictEqual(inventory.slots[10], null)
+                  assert.strictEqual(inventory.slots[5].type, helmet)
+                  done()
+                })
+                assert.strictEqual(inventory.slots[10].type, helmet)
+              })
+              assert.strictEqual(inventory.slots[12].count, 5)
+              assert.strictEqual(inventory.slots[13].count, 5)
+              assert.strictEqual(inventory.selectedItem, null)
+            })
+          })
+          assert.strictEqual(inventory.slots[36], null)
+          assert.strictEqual(inventory.slots[37].type, stone)
+        })
+        assert.strictEqual(inventory.slots[9], null)
+        assert.strictEqual(inventory.slots[36].type, stone)
+        assert.strictEqual(inventory.slots[36].count, 10)
+      })
+      server.on('login', (client) => {
+        client.on('window_click', (packet) => {
+          if (packet.slot === 10 && packet.mode === 1) {
+            client.write('set_slot', { windowId: 0, slot: 10, item: Item.toNotch(null) })
+            client.write('set_slot', { windowId: 0, slot: 5, item: Item.toNotch(new Item(helmet, 1)) })
+          }
+          client.write('transaction', { windowId: 0, action: packet.action, accepted: true })
+        })
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        const items = []
+        for (let i = 0; i < bot.inventory.slots.length; i++) {
+          items.push(Item.toNotch(i === 9 ? new Item(stone, 10) : i === 10 ? new Item(helmet, 1) : null))
+        }
+        client.write('window_items', { windowId: 0, items })
+        client.write('held_item_slot', { slot: 0 })
+      })
+    })
+
+    it('shift clicks of heads, pumpkins and the off hand are left to the server', (done) => {
+      const Item = require('prismarine-item')(supportedVersion)
+      const stone = mcData.blocksByName.stone.id
+      const head = (mcData.itemsByName.skull || mcData.itemsByName.skeleton_skull).id
+      const pumpkin = (mcData.itemsByName.pumpkin || mcData.blocksByName.pumpkin).id
+      const offHand = version.majorVersion !== '1.8'
+      bot.once('setWindowItems:0', () => {
+        const inventory = bot.inventory
+        inventory.transactionRequiresConfirmation = () => true
+        let clicks = offHand ? 3 : 2
+        const clicked = (err) => {
+          assert.ifError(err)
+          if (--clicks === 0) done()
+        }
+        bot.clickWindow(9, 0, 1, clicked)
+        bot.clickWindow(10, 0, 1, clicked)
+        if (offHand) bot.clickWindow(45, 0, 1, clicked)
+        // none of them was applied before the server answered
+        assert.strictEqual(inventory.slots[9].type, head)
+        assert.strictEqual(inventory.slots[10].type, pumpkin)
+        if (offHand) assert.strictEqual(inventory.slots[45].type, stone)
+        assert.ok(inventory.slots.slice(36, 45).every(item => item === null))
+      })
+      server.on('login', (client) => {
+        client.on('window_click', (packet) => {
+          client.write('transaction', { windowId: 0, action: packet.action, accepted: true })
+        })
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        const items = []
+        for (let i = 0; i < bot.inventory.slots.length; i++) {
+          items.push(Item.toNotch(i === 9 ? new Item(head, 1) : i === 10 ? new Item(pumpkin, 1) : i === 45 ? new Item(stone, 5) : null))
+        }
+        client.write('window_items', { windowId: 0, items })
+      })
+    })
+
+    it('chat messages keep their children as own properties', () => {
+      const ChatMessage = require('../lib/chat_message')(supportedVersion)
+      const message = new ChatMessage({ translate: 'chat.type.text', with: [{ text: 'gary' }, 'hello'], extra: [{ text: '!', bold: true }] })
+      const keys = Object.keys(message)
+      assert.ok(keys.includes('with'))
+      assert.ok(keys.includes('extra'))
+      assert.ok(!keys.some(key => key.startsWith('_')))
+      assert.ok(!Object.keys(new ChatMessage('plain')).includes('extra'))
+      const json = JSON.parse(JSON.stringify(message))
+      assert.deepStrictEqual(json.with.map(entry => entry.text), ['gary', 'hello'])
+      assert.strictEqual(json.extra[0].bold, true)
+      assert.ok(message.toString().includes('gary'))
+      assert.ok(message.toString().endsWith('hello!'))
+      // the message itself is checked right away, its children when they are built
+      assert.throws(() => new ChatMessage({ text: 'a', extra: {} }), /extra property to be an Array/)
+      const malformed = new ChatMessage({ text: 'a', extra: [{ text: 'b', extra: {} }] })
+      assert.throws(() => malformed.extra, /extra property to be an Array/)
+      const withNumber = new ChatMessage({ translate: 'chat.type.text', with: [5] })
+      assert.throws(() => withNumber.toString(), /Expected String or Object/)
+      const clickEvent = new ChatMessage({ text: 'a', extra: [{ text: 'b', clickEvent: {} }] })
+      assert.throws(() => clickEvent.extra, /ClickEvent action missing/)
+    })
+
+    it('maxColumns evicts the farthest columns once the position is known', (done) => {
+      const chunk = new Chunk()
+      chunk.setBlockType(vec3(0, 0, 0), 1)
+      const limited = mineflayer.createBot({ username: 'limited', version: supportedVersion, port: 25567, maxColumns: 2 })
+      let loaded = 0
+      limited.on('chunkColumnLoad', () => {
+        // nothing is evicted before the bot knows where it is
+        if (++loaded === 4) assert.strictEqual(limited.chunkMemoryUsage().columns, 4)
+      })
+      const unloaded = []
+      limited.on('chunkColumnUnload', (corner) => {
+        unloaded.push(corner.x / 16)
+        if (unloaded.length < 3) return
+        // the farthest from (0, 0), then the farthest from (6, 0)
+        assert.deepStrictEqual(unloaded, [6, 5, 0])
+        assert.strictEqual(limited.chunkMemoryUsage().columns, 2)
+        limited.end()
+        done()
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        if (client.username !== 'limited') return
+        const sendColumn = (x) => client.write('map_chunk', {
+          x,
+          z: 0,
+          groundUp: true,
+          bitMap: chunk.getMask(),
+          chunkData: chunk.dump(),
+          blockEntities: []
+        })
+        for (const x of [0, 1, 5, 6]) sendColumn(x)
+        client.write('position', { x: 0.5, y: 80, z: 0.5, yaw: 0, pitch: 0, flags: 0, teleportId: 0 })
+        client.write('position', { x: 6 * 16 + 0.5, y: 80, z: 0.5, yaw: 0, pitch: 0, flags: 0, teleportId: 1 })
+        sendColumn(7)
+      })
+    })
+
+    it('the block index only decodes lazily loaded columns when queried', (done) => {
+      const goldId = 41
+      const chunk = new Chunk()
+      chunk.setBlockType(vec3(1, 64, 1), goldId)
+      const goldStateId = chunk.getBlockStateId(vec3(1, 64, 1))
+      const indexed = mineflayer.createBot({ username: 'indexed', version: supportedVersion, port: 25567, lazyChunkLoading: true, indexedBlocks: [goldId] })
+      indexed.once('chunkColumnLoad', () => {
+        assert.strictEqual(indexed.chunkMemoryUsage().pendingColumns, 1)
+      })
+      indexed.once(`blockUpdate:${vec3(2, 64, 2)}`, () => {
+        const positions = indexed.blockIndex.find({ matching: goldId, point: vec3(0, 64, 0), count: 2 })
+        assert.deepStrictEqual(positions.map(position => position.toString()), [vec3(1, 64, 1).toString(), vec3(2, 64, 2).toString()])
+        assert.strictEqual(indexed.chunkMemoryUsage().pendingColumns, 0)
+        indexed.end()
+        done()
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        if (client.username !== 'indexed') return
+        client.write('map_chunk', {
+          x: 0,
+          z: 0,
+          groundUp: true,
+          bitMap: chunk.getMask(),
+          chunkData: chunk.dump(),
+          blockEntities: []
+        })
+        client.write('block_change', { location: { x: 2, y: 64, z: 2 }, type: goldStateId })
+      })
+    })
+
+    it('decoded columns are only revived with the shape of the template', () => {
+      const v8 = require('v8')
+      const chunkDecoder = require('../lib/chunk_decoder')
+      const template = chunkDecoder.createTemplate(supportedVersion)
+      const chunk = new Chunk()
+      chunk.setBlockType(vec3(1, 64, 1), 41)
+      const column = new Chunk()
+      column.load(chunk.dump(), chunk.getMask(), true)
+      // what the worker posts is structured cloned, without the prototypes
+      const copy = () => v8.deserialize(v8.serialize(column))
+      const revived = chunkDecoder.revive(copy(), template)
+      assert.ok(revived instanceof Chunk)
+      assert.strictEqual(revived.getBlockStateId(vec3(1, 64, 1)), column.getBlockStateId(vec3(1, 64, 1)))
+      assert.ok(revived.dump().equals(column.dump()))
+      const extra = copy()
+      extra.unexpected = 1
+      assert.throws(() => chunkDecoder.revive(extra, template), /expected shape/)
+      const missing = copy()
+      delete missing[Object.keys(missing)[0]]
+      assert.throws(() => chunkDecoder.revive(missing, template), /expected shape/)
+    })
+
+    it('lazyChunkLoading decodes a column when it is first read', (done) => {
+      const goldId = 41
+      const chunk = new Chunk()
+      chunk.setBlockType(vec3(1, 64, 1), goldId)
+      const lazy = mineflayer.createBot({ username: 'lazy', version: supportedVersion, port: 25567, lazyChunkLoading: true })
+      lazy.once('chunkColumnLoad', () => {
+        assert.strictEqual(lazy.chunkMemoryUsage().pendingColumns, 1)
+        assert.strictEqual(lazy.blockAt(vec3(1, 64, 1)).type, goldId)
+        assert.strictEqual(lazy.chunkMemoryUsage().pendingColumns, 0)
+        assert.strictEqual(lazy.blockAt(vec3(1, 65, 1)).type, 0)
+        lazy.end()
+        done()
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        if (client.username !== 'lazy') return
+        client.write('map_chunk', {
+          x: 0,
+          z: 0,
+          groundUp: true,
+          bitMap: chunk.getMask(),
+          chunkData: chunk.dump(),
+          blockEntities: []
+        })
+      })
+    })
+
+    it('fixedTimestepPhysics catches up 10 ticks at most', (done) => {
+      const fixed = mineflayer.createBot({ username: 'fixed', version: supportedVersion, port: 25567, fixedTimestepPhysics: true })
+      // blocking, then measuring the batches of ticks simulated in one go
+      let state = 'waiting'
+      let batch = 0
+      const batches = []
+      fixed.on('physicsTick', () => {
+        if (state === 'waiting') {
+          state = 'blocking'
+          // a second late, the 20 ticks missed are more than the cap
+          const end = Date.now() + 1000
+          while (Date.now() < end) { /* the event loop is busy */ }
+          process.nextTick(() => { state = 'measuring' })
+          return
+        }
+        if (state !== 'measuring' || batch++ !== 0) return
+        process.nextTick(() => {
+          batches.push(batch)
+          batch = 0
+          if (batches.length < 2) return
+          assert.strictEqual(batches[0], 10)
+          // the ticks beyond the cap were dropped, not simulated later
+          assert.ok(batches[1] <= 2)
+          fixed.end()
+          done()
+        })
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        if (client.username !== 'fixed') return
+        client.write('position', { x: 0.5, y: 80, z: 0.5, yaw: 0, pitch: 0, flags: 0, teleportId: 0 })
+      })
+    })
+
+    it('batchEntityEvents reports the entities that changed once per tick', (done) => {
+      const entities = mcData.entitiesByName
+      const creeperId = entities.creeper ? entities.creeper.id : entities.Creeper.id
+      const batched = mineflayer.createBot({ username: 'batched', version: supportedVersion, port: 25567, batchEntityEvents: true })
+      batched.on('entityMoved', () => assert.fail('entityMoved is not emitted with batchEntityEvents'))
+      batched.on('entityUpdate', () => assert.fail('entityUpdate is not emitted with batchEntityEvents'))
+      const moved = new Set()
+      let updated = false
+      function check () {
+        if (moved.size < 2 || !updated) return
+        assert.strictEqual(batched.entities[8].position.x > batched.entities[9].position.x, true)
+        batched.end()
+        done()
+      }
+      batched.on('entitiesMoved', (list) => {
+        const ids = list.map(entity => entity.id)
+        // moved three times, reported once
+        assert.strictEqual(new Set(ids).size, ids.length)
+        for (const id of ids) moved.add(id)
+        check()
+      })
+      batched.on('entitiesUpdated', (list) => {
+        if (list.some(entity => entity.id === 8)) updated = true
+        check()
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        if (client.username !== 'batched') return
+        for (const entityId of [8, 9]) {
+          client.write('spawn_entity_living', {
+            entityId,
+            entityUUID: '00112233-4455-6677-8899-aabbccddeeff',
+            type: creeperId,
+            x: 0,
+            y: 0,
+            z: 0,
+            yaw: 0,
+            pitch: 0,
+            headPitch: 0,
+            velocityX: 0,
+            velocityY: 0,
+            velocityZ: 0,
+            metadata: []
+          })
+        }
+        const dX = version.majorVersion === '1.8' ? 32 : 128 * 32
+        for (let i = 0; i < 3; i++) client.write('rel_entity_move', { entityId: 8, dX, dY: 0, dZ: 0, onGround: true })
+        client.write('rel_entity_move', { entityId: 9, dX: -dX, dY: 0, dZ: 0, onGround: true })
+        client.write('entity_metadata', { entityId: 8, metadata: [] })
+      })
+    })
+
+    it('entities left out by entityFilter are forgotten on respawn', (done) => {
+      const entities = mcData.entitiesByName
+      const creeperId = entities.creeper ? entities.creeper.id : entities.Creeper.id
+      const filtered = mineflayer.createBot({ username: 'filtered', version: supportedVersion, port: 25567, entityFilter: ['player'] })
+      let respawned = false
+      filtered.on('respawn', () => { respawned = true })
+      filtered.on('entityMoved', (entity) => {
+        // the id now stands for an entity of the new world
+        assert.ok(respawned)
+        assert.strictEqual(entity.id, 8)
+        filtered.end()
+        done()
+      })
+      server.on('login', (client) => {
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        if (client.username !== 'filtered') return
+        client.write('spawn_entity_living', {
+          entityId: 8,
+          entityUUID: '00112233-4455-6677-8899-aabbccddeeff',
+          type: creeperId,
+          x: 0,
+          y: 0,
+          z: 0,
+          yaw: 0,
+          pitch: 0,
+          headPitch: 0,
+          velocityX: 0,
+          velocityY: 0,
+          velocityZ: 0,
+          metadata: []
+        })
+        const dX = version.majorVersion === '1.8' ? 32 : 128 * 32
+        client.write('rel_entity_move', { entityId: 8, dX, dY: 0, dZ: 0, onGround: true })
+        client.write('respawn', { dimension: 0, difficulty: 0, gamemode: 0, levelType: 'default' })
+        client.write('rel_entity_move', { entityId: 8, dX, dY: 0, dZ: 0, onGround: true })
+      })
+    })
+
+    it('planCraft crafts the missing ingredients first', () => {
+      const Item = require('prismarine-item')(supportedVersion)
+      const items = mcData.itemsByName
+      const log = (items.oak_log || items.log).id
+      const planks = (items.oak_planks || items.planks).id
+      const stick = items.stick.id
+      const pickaxe = items.wooden_pickaxe.id
+      const times = (plan, type) => plan.steps.filter(step => step.recipe.result.id === type).reduce((sum, step) => sum + step.count, 0)
+
+      bot.inventory.updateSlot(36, new Item(log, 1, 0))
+      // one log is 4 planks, 2 of them are 4 sticks
+      const sticks = bot.planCraft(stick, 4)
+      assert.deepStrictEqual(sticks.steps.map(step => step.recipe.result.id), [planks, stick])
+      assert.strictEqual(sticks.requiresTable, false)
+      // 3 planks and 2 sticks are 5 planks, more than one log
+      assert.strictEqual(bot.planCraft(pickaxe, 1, { craftingTable: true }), null)
+
+      bot.inventory.updateSlot(36, new Item(log, 2, 0))
+      assert.strictEqual(bot.planCraft(pickaxe, 1), null)
+      const plan = bot.planCraft(pickaxe, 1, { craftingTable: true })
+      assert.strictEqual(plan.requiresTable, true)
+      assert.strictEqual(times(plan, planks), 2)
+      assert.strictEqual(times(plan, stick), 1)
+      assert.strictEqual(plan.steps[plan.steps.length - 1].recipe.result.id, pickaxe)
+      assert.strictEqual(plan.steps[plan.steps.length - 1].count, 1)
+    })
+
+    it('unloading a column drops its signs, block entities and paintings', (done) => {
+      const chunk = new Chunk()
+      chunk.setBlockType(vec3(0, 0, 0), 1)
+      const signNbt = (x, z) => ({
+        type: 'compound',
+        name: '',
+        value: {
+          id: { type: 'string', value: 'minecraft:sign' },
+          x: { type: 'int', value: x },
+          y: { type: 'int', value: 64 },
+          z: { type: 'int', value: z },
+          Text1: { type: 'string', value: JSON.stringify({ text: 'hello' }) },
+          Text2: { type: 'string', value: '' },
+          Text3: { type: 'string', value: '' },
+          Text4: { type: 'string', value: '' }
+        }
+      })
+      let serverClient
+      const sendColumn = (x, bitMap) => serverClient.write('map_chunk', {
+        x,
+        z: 0,
+        groundUp: true,
+        bitMap,
+        chunkData: bitMap ? chunk.dump() : Buffer.alloc(0),
+        blockEntities: []
+      })
+      bot.once('chat', () => {
+        assert.strictEqual(bot.blockAt(vec3(1, 64, 1)).signText, 'hello\n\n\n')
+        assert.ok(bot.blockAt(vec3(2, 64, 2)).painting)
+        assert.strictEqual(bot.blockAt(vec3(17, 64, 1)).signText, 'hello\n\n\n')
+        bot.once('chunkColumnUnload', () => {
+          bot.once('chunkColumnLoad', () => {
+            // nothing of the old column comes back with the new one
+            const block = bot.blockAt(vec3(1, 64, 1))
+            assert.strictEqual(block.signText, undefined)
+            assert.strictEqual(block.blockEntity, undefined)
+            assert.strictEqual(bot.blockAt(vec3(2, 64, 2)).painting, undefined)
+            // the other column keeps its own
+            assert.strictEqual(bot.blockAt(vec3(17, 64, 1)).signText, 'hello\n\n\n')
+            done()
+          })
+          sendColumn(0, chunk.getMask())
+        })
+        sendColumn(0, 0)
+      })
+      server.on('login', (client) => {
+        serverClient = client
+        client.write('login', {
+          entityId: 0,
+          levelType: 'fogetaboutit',
+          gameMode: 0,
+          dimension: 0,
+          difficulty: 0,
+          maxPlayers: 20,
+          reducedDebugInfo: true
+        })
+        sendColumn(0, chunk.getMask())
+        sendColumn(1, chunk.getMask())
+        client.write('tile_entity_data', { location: { x: 1, y: 64, z: 1 }, action: 9, nbtData: signNbt(1, 1) })
+        client.write('tile_entity_data', { location: { x: 17, y: 64, z: 1 }, action: 9, nbtData: signNbt(17, 1) })
+        client.write('spawn_entity_painting', {
+          entityId: 5,
+          entityUUID: '00000000-0000-0000-0000-000000000005',
+          title: version.majorVersion === '1.13' ? 0 : 'Kebab',
+          location: { x: 2, y: 64, z: 2 },
+          direction: 0
+        })
+        const message = JSON.stringify({ translate: 'chat.type.text', with: [{ text: 'gary' }, 'hello'] })
+        client.write('chat', { message, position: 0 })
+      })
+    })
+
     describe('tablist', () => {
       it('handles newlines in header and footer', (done) => {
         const HEADER = 'asd\ndsa'